@@ -0,0 +1,207 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+//
+// Benchmark of the text path, writing one JSON object per line to stdout.
+//
+// Build from the repository root with:
+//   g++ -std=c++17 -O2 -I. bench/text_bench.cpp -o text_bench
+//     $(pkg-config --cflags --libs sdl2 SDL2_ttf fontconfig) -pthread
+//
+// Usage:
+//   text_bench [font name]...
+//
+// Runs under the dummy video driver with the software renderer, so it needs
+// no display. Fonts default to "Sans" and "Monospace".
+
+#include "font_metrics.h"
+#include "glyph_atlas.h"
+#include "sdl2.h"
+#include "ttf.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct script
+  {
+    char const* name;
+    char const* sample;
+  };
+
+  script const scripts[] = {
+    {"latin", "The quick brown fox jumps over the lazy dog. "},
+    {"greek", "Ξεσκεπάζω την ψυχοφθόρα βδελυγμία. "},
+    {"cyrillic", "Съешь же ещё этих мягких французских булок. "},
+    {"cjk", "我能吞下玻璃而不伤身体。"},
+    {"arabic", "أنا قادر على أكل الزجاج و هذا لا يؤلمني. "},
+  };
+
+  struct hinting
+  {
+    char const* name;
+    int value;
+  };
+
+  hinting const hintings[] = {
+    {"normal", TTF_HINTING_NORMAL},
+    {"light", TTF_HINTING_LIGHT},
+    {"mono", TTF_HINTING_MONO},
+    {"none", TTF_HINTING_NONE},
+  };
+
+  int const point_sizes[] = {10, 16, 32, 64};
+  std::size_t const lengths[] = {8, 64, 512};
+
+  // Repeats a sample until it has the specified number of code points
+  std::string make_text(char const* sample, std::size_t length)
+  {
+    std::string s(sample);
+    std::string text;
+    std::size_t count = 0;
+    std::size_t pos = 0;
+    while( count < length )
+    {
+      if( pos == s.size() )
+      {
+        pos = 0;
+      }
+      auto start = pos;
+      sdl::ttf::next_code_point(s, pos);
+      text.append(s, start, pos - start);
+      ++count;
+    }
+    return text;
+  }
+
+  struct params
+  {
+    std::string font;
+    char const* script = "";
+    std::size_t length = 0;
+    int point_size = 0;
+    char const* hinting = "";
+  };
+
+  // Runs f repeatedly for at least 50ms and reports the mean time per call
+  template<class Function>
+  void run(char const* op, params const& p, Function&& f)
+  {
+    using clock = std::chrono::steady_clock;
+    auto const minimum = std::chrono::milliseconds(50);
+    unsigned long iterations = 0;
+    auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+    do
+    {
+      f();
+      ++iterations;
+      elapsed = clock::now() - start;
+    } while( elapsed < minimum );
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    std::printf("{\"op\":\"%s\",\"font\":\"%s\",\"script\":\"%s\",\"length\":%zu,"
+                "\"point_size\":%d,\"hinting\":\"%s\",\"iterations\":%lu,"
+                "\"ns_per_op\":%.1f}\n",
+                op,
+                p.font.c_str(),
+                p.script,
+                p.length,
+                p.point_size,
+                p.hinting,
+                iterations,
+                static_cast<double>(ns) / iterations);
+    std::fflush(stdout);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> fonts(argv + 1, argv + argc);
+  if( fonts.empty() )
+  {
+    fonts = {"Sans", "Monospace"};
+  }
+
+  try
+  {
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    auto sdl_lib = sdl::init();
+    auto sdl_ttf_lib = sdl::ttf::init();
+
+    sdl::surface target(SDL_CreateRGBSurfaceWithFormat(0, 1024, 768, 32,
+                                                       SDL_PIXELFORMAT_ARGB8888),
+                        SDL_FreeSurface);
+    sdl::renderer renderer(SDL_CreateSoftwareRenderer(target.get()),
+                           SDL_DestroyRenderer);
+    if( !renderer )
+    {
+      sdl::throw_error("Failed to create software renderer: ");
+    }
+
+    for( auto& font_name : fonts )
+    {
+      params p;
+      p.font = font_name;
+      auto font_file = sdl::ttf::resolve_font(font_name);
+
+      for( int point_size : point_sizes )
+      {
+        p.point_size = point_size;
+        p.script = "";
+        p.length = 0;
+        p.hinting = "";
+        run("open_font", p, [&]() { sdl::ttf::open_font(font_name, point_size); });
+        run("open_font_file", p, [&]() { sdl::ttf::open_font_file(font_file.c_str(), point_size); });
+
+        for( auto& hint : hintings )
+        {
+          p.hinting = hint.name;
+          auto f = sdl::ttf::open_font_file(font_file.c_str(), point_size);
+          if( !f )
+          {
+            sdl::ttf::throw_error("Failed to open " + font_file + ": ");
+          }
+          TTF_SetFontHinting(f.get(), hint.value);
+          sdl::ttf::font_metrics metrics(f);
+          sdl::ttf::glyph_atlas atlas(renderer, f);
+
+          for( auto& s : scripts )
+          {
+            p.script = s.name;
+            for( auto length : lengths )
+            {
+              p.length = length;
+              auto text = make_text(s.sample, length);
+              int w = 0;
+              int h = 0;
+              run("size", p, [&]() { sdl::ttf::size(f, text, &w, &h); });
+              run("metrics_size", p, [&]() { sdl::ttf::size(metrics, text, &w, &h); });
+              run("render_blended", p, [&]() { sdl::ttf::render_blended(f, text, sdl::white); });
+
+              auto rendered = sdl::ttf::render_blended(f, text, sdl::white);
+              if( rendered )
+              {
+                run("create_texture_from_surface", p, [&]()
+                {
+                  sdl::create_texture_from_surface(renderer, rendered);
+                });
+              }
+              run("atlas_draw", p, [&]() { atlas.draw(text, 0.0f, 0.0f, sdl::white); });
+            }
+          }
+        }
+      }
+    }
+  }
+  catch( std::exception const& e )
+  {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
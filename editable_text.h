@@ -0,0 +1,393 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_EDITABLE_TEXT_H
+#define SDL2_CPP_EDITABLE_TEXT_H
+
+#include "font_metrics.h"
+#include "ttf.h"
+
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** A single line of text that is edited in place.
+
+        The placement of each glyph is kept, so an insertion or deletion only
+        decodes the changed bytes, re-composites the glyphs in the span whose
+        pixels changed and uploads that sub-rectangle of the texture with
+        SDL_UpdateTexture.
+
+        The line is held in a row of fixed width texture tiles, no wider than
+        the renderer's maximum texture width, so its length is not limited
+        by the renderer. Only the tiles overlapping a change are redrawn.
+
+        The renderer must outlive the editable_text.
+    */
+    class editable_text
+    {
+    public:
+      editable_text(renderer const& r, font f, SDL_Color const& c = white)
+        : r_(r)
+        , font_(std::move(f))
+        , metrics_(font_)
+        , colour_(c)
+        , scratch_(nullptr, SDL_FreeSurface)
+      {
+        SDL_RendererInfo info;
+        if( SDL_GetRendererInfo(r_.get(), &info) == 0 && info.max_texture_width > 0 )
+        {
+          tile_width_ = std::min(tile_width_, info.max_texture_width);
+        }
+      }
+
+      editable_text(editable_text const&) = delete;
+      void operator=(editable_text const&) = delete;
+
+      std::string const& text() const
+      {
+        return text_;
+      }
+
+      /** Returns the width in pixels of the text */
+      int width() const
+      {
+        return width_;
+      }
+
+      int height() const
+      {
+        return metrics_.height();
+      }
+
+      void set_colour(SDL_Color const& c)
+      {
+        colour_ = c;
+      }
+
+      /** Returns the pen position of the glyph at a byte offset, or the width
+          of the text if the offset is at or past its end
+      */
+      int x_at(std::size_t offset) const
+      {
+        auto g = std::lower_bound(glyphs_.begin(), glyphs_.end(), offset, before_offset);
+        return g != glyphs_.end() ? g->x : pen_end_;
+      }
+
+      /** Inserts UTF-8 text at a byte offset */
+      void insert(std::size_t offset, std::string_view s)
+      {
+        replace(offset, 0, s);
+      }
+
+      /** Erases length bytes starting at a byte offset */
+      void erase(std::size_t offset, std::size_t length)
+      {
+        replace(offset, length, {});
+      }
+
+      /** Replaces the whole text */
+      void set_text(std::string_view s)
+      {
+        replace(0, text_.size(), s);
+      }
+
+      /** Draws the text with its top left at (x, y) */
+      void render(int x, int y)
+      {
+        for( std::size_t i = 0; i < tiles_.size(); ++i )
+        {
+          int left = static_cast<int>(i) * tile_width_;
+          int w = std::min(tile_width_, width_ - left);
+          if( w <= 0 )
+          {
+            break;
+          }
+          auto& tile = tiles_[i];
+          SDL_SetTextureColorMod(tile.get(), colour_.r, colour_.g, colour_.b);
+          SDL_SetTextureAlphaMod(tile.get(), colour_.a);
+          SDL_Rect src{0, 0, w, height()};
+          SDL_Rect dst{x + left, y, w, height()};
+          SDL_RenderCopy(r_.get(), tile.get(), &src, &dst);
+        }
+      }
+
+    private:
+      struct placed
+      {
+        Uint32 code_point;
+        std::size_t offset;
+        int x;
+      };
+
+      static bool before_offset(placed const& g, std::size_t offset)
+      {
+        return g.offset < offset;
+      }
+
+      static bool before_x(placed const& g, int x)
+      {
+        return g.x < x;
+      }
+
+      // Replaces length bytes at offset with s. Only the glyphs decoded from
+      // the changed bytes are placed afresh; the glyphs after them keep their
+      // code points and move by the change in pen position.
+      void replace(std::size_t offset, std::size_t length, std::string_view s)
+      {
+        offset = std::min(offset, text_.size());
+        length = std::min(length, text_.size() - offset);
+
+        // The changed glyphs start with the one containing offset, or the one
+        // before if it is a malformed sequence the new bytes may complete
+        auto first = static_cast<std::size_t>(
+          std::lower_bound(glyphs_.begin(), glyphs_.end(), offset, before_offset) - glyphs_.begin());
+        auto old_start = [this](std::size_t i)
+        {
+          return i < glyphs_.size() ? glyphs_[i].offset : text_.size();
+        };
+        if( first > 0 && (old_start(first) != offset || glyphs_[first - 1].code_point == 0xFFFD) )
+        {
+          --first;
+        }
+        auto last = static_cast<std::size_t>(
+          std::lower_bound(glyphs_.begin() + first, glyphs_.end(), offset + length, before_offset) -
+          glyphs_.begin());
+        auto begin = old_start(first);
+
+        text_.replace(offset, length, s);
+        auto new_start = [this, length, &s](std::size_t i)
+        {
+          return i < glyphs_.size() ? glyphs_[i].offset - length + s.size() : text_.size();
+        };
+
+        // Decode up to the next unchanged glyph, which a malformed sequence
+        // may run past
+        std::vector<placed> changed;
+        std::size_t pos = begin;
+        while( pos < new_start(last) )
+        {
+          auto start = pos;
+          changed.push_back(placed{next_code_point(text_, pos), start, 0});
+          while( last < glyphs_.size() && new_start(last) < pos )
+          {
+            ++last;
+          }
+        }
+
+        bool has_previous = first > 0;
+        Uint32 previous = has_previous ? glyphs_[first - 1].code_point : 0;
+        int x = has_previous ? glyphs_[first - 1].x + metrics_.advance(previous) : 0;
+        for( auto& g : changed )
+        {
+          if( has_previous )
+          {
+            x += metrics_.kerning(previous, g.code_point);
+          }
+          g.x = x;
+          x += metrics_.advance(g.code_point);
+          previous = g.code_point;
+          has_previous = true;
+        }
+
+        // The dirty span covers the pixels of every changed glyph, before
+        // and after the edit
+        int left = INT_MAX;
+        int right = INT_MIN;
+        auto extend = [this, &left, &right](placed const& g)
+        {
+          auto& b = bitmap(g.code_point);
+          left = std::min(left, g.x + std::min(0, b.x_offset));
+          right = std::max(right, g.x + right_extent(b));
+        };
+        for( auto i = first; i < last; ++i )
+        {
+          extend(glyphs_[i]);
+        }
+        for( auto& g : changed )
+        {
+          extend(g);
+        }
+
+        // Every following glyph moves with the pen, so if the pen moved the
+        // rest of the line is dirty
+        int shift = 0;
+        if( last < glyphs_.size() )
+        {
+          if( has_previous )
+          {
+            x += metrics_.kerning(previous, glyphs_[last].code_point);
+          }
+          shift = x - glyphs_[last].x;
+          if( shift != 0 )
+          {
+            left = std::min(left, std::min(x, glyphs_[last].x) - max_left_);
+          }
+          for( auto i = last; i < glyphs_.size(); ++i )
+          {
+            glyphs_[i].offset = glyphs_[i].offset - length + s.size();
+            glyphs_[i].x += shift;
+          }
+          pen_end_ += shift;
+        }
+        else
+        {
+          pen_end_ = x;
+        }
+        glyphs_.erase(glyphs_.begin() + first, glyphs_.begin() + last);
+        glyphs_.insert(glyphs_.begin() + first, changed.begin(), changed.end());
+
+        int old_width = width_;
+        width_ = pen_end_;
+        for( auto g = std::lower_bound(glyphs_.begin(), glyphs_.end(), pen_end_ - max_right_, before_x);
+             g != glyphs_.end();
+             ++g )
+        {
+          width_ = std::max(width_, g->x + right_extent(bitmap(g->code_point)));
+        }
+        if( shift != 0 )
+        {
+          right = std::max(old_width, width_);
+        }
+
+        if( left >= right )
+        {
+          return;
+        }
+        int added = reserve(std::max(width_, old_width));
+        redraw(std::max(0, left), std::min(capacity(), right));
+        redraw(added, capacity());
+      }
+
+      static int right_extent(glyph_bitmap const& b)
+      {
+        return std::max(b.advance, b.pixels ? b.x_offset + b.pixels->w : 0);
+      }
+
+      int capacity() const
+      {
+        return static_cast<int>(tiles_.size()) * tile_width_;
+      }
+
+      // Adds tiles until they cover the specified width. Returns the left
+      // edge of the first added tile, which must be drawn in full, or the
+      // previous capacity if none were added.
+      int reserve(int w)
+      {
+        int added = capacity();
+        if( !scratch_ )
+        {
+          scratch_ = surface(SDL_CreateRGBSurfaceWithFormat(0, tile_width_, height(), 32,
+                                                            SDL_PIXELFORMAT_ARGB8888),
+                             SDL_FreeSurface);
+          if( !scratch_ )
+          {
+            sdl::throw_error("Failed to create text surface: ");
+          }
+        }
+        while( capacity() < w )
+        {
+          texture tile(SDL_CreateTexture(r_.get(),
+                                         SDL_PIXELFORMAT_ARGB8888,
+                                         SDL_TEXTUREACCESS_STREAMING,
+                                         tile_width_,
+                                         height()),
+                       SDL_DestroyTexture);
+          if( !tile )
+          {
+            sdl::throw_error("Failed to create text texture: ");
+          }
+          SDL_SetTextureBlendMode(tile.get(), SDL_BLENDMODE_BLEND);
+          tiles_.push_back(std::move(tile));
+        }
+        return added;
+      }
+
+      // Composites the glyphs overlapping [left, right) and uploads that
+      // span of each tile it covers
+      void redraw(int left, int right)
+      {
+        for( int tile_left = left - left % tile_width_;
+             tile_left < right;
+             tile_left += tile_width_ )
+        {
+          int l = std::max(left, tile_left);
+          int r = std::min(right, tile_left + tile_width_);
+
+          // Transparent white, so blended edges keep the glyph colour
+          SDL_Rect dirty{l - tile_left, 0, r - l, height()};
+          SDL_Rect clip = dirty;
+          SDL_SetClipRect(scratch_.get(), &clip);
+          SDL_FillRect(scratch_.get(), &dirty, 0x00FFFFFF);
+          // Pen positions never decrease, so the glyphs whose pixels can
+          // reach [l, r) are a contiguous run
+          for( auto g = std::lower_bound(glyphs_.begin(), glyphs_.end(), l - max_right_, before_x);
+               g != glyphs_.end() && g->x - max_left_ < r;
+               ++g )
+          {
+            auto& b = bitmap(g->code_point);
+            if( !b.pixels )
+            {
+              continue;
+            }
+            SDL_Rect at{g->x + b.x_offset - tile_left, b.y_offset, b.pixels->w, b.pixels->h};
+            if( at.x < dirty.x + dirty.w && at.x + at.w > dirty.x )
+            {
+              SDL_BlitSurface(b.pixels.get(), nullptr, scratch_.get(), &at);
+            }
+          }
+          SDL_SetClipRect(scratch_.get(), nullptr);
+
+          auto pixels = static_cast<Uint8*>(scratch_->pixels) + dirty.x * 4;
+          SDL_UpdateTexture(tiles_[tile_left / tile_width_].get(), &dirty, pixels, scratch_->pitch);
+        }
+      }
+
+      glyph_bitmap const& bitmap(Uint32 code_point)
+      {
+        auto cached = bitmaps_.find(code_point);
+        if( cached == bitmaps_.end() )
+        {
+          auto b = render_glyph(font_, code_point);
+          if( b.pixels )
+          {
+            SDL_SetSurfaceBlendMode(b.pixels.get(), SDL_BLENDMODE_BLEND);
+          }
+          max_left_ = std::max(max_left_, -std::min(0, b.x_offset));
+          max_right_ = std::max(max_right_, right_extent(b));
+          cached = bitmaps_.emplace(code_point, std::move(b)).first;
+        }
+        return cached->second;
+      }
+
+    private:
+      renderer const& r_;
+      font font_;
+      font_metrics metrics_;
+      SDL_Color colour_;
+      std::string text_;
+      std::vector<placed> glyphs_;
+      std::unordered_map<Uint32, glyph_bitmap> bitmaps_;
+      int pen_end_ = 0;
+      int width_ = 0;
+      // The furthest any cached glyph's pixels reach left and right of its
+      // pen position
+      int max_left_ = 0;
+      int max_right_ = 0;
+      int tile_width_ = 1024;
+      std::vector<texture> tiles_;
+      surface scratch_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_EDITABLE_TEXT_H
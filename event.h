@@ -6,13 +6,63 @@
 #ifndef SDL2_CPP_EVENT_H
 #define SDL2_CPP_EVENT_H
 
+#include <array>
+#include <cstdint>
 #include <functional>
+#include "inplace_function.h"
 #include <SDL2/SDL.h>
+#include <unordered_map>
 #include <vector>
 
 namespace sdl2
 {
+  namespace detail
+  {
+    /** Rate limits the repeat events of a held key */
+    class key_repeat_limiter
+    {
+    public:
+      /** Returns true if the key down event should be ignored */
+      bool rate_limited(SDL_Event const& e)
+      {
+        if( e.key.repeat == 0 )
+        {
+          key_repeat_count_ = 0;
+        }
+        else
+        {
+          key_repeat_count_++;
+        }
+        auto last_key_timestamp = last_key_timestamp_;
+        last_key_timestamp_ = e.key.timestamp;
+
+        return (e.key.repeat != 0 &&
+                (e.key.timestamp - last_key_timestamp) <
+                (key_repeat_count_ > 0 ? 25 : 500));
+      }
+
+    private:
+      unsigned int last_key_timestamp_ = 0;
+      unsigned int key_repeat_count_ = 0;
+    };
+  } // namespace detail
+
   /** Map SDL events to handler functions.
+
+      Handlers are grouped by event type, so an event is only offered to the
+      handlers registered for its type. SDL's built in event types are found
+      through a small dense table and other types, such as those registered
+      with SDL_RegisterEvents, through a hash map. Key handlers are further
+      indexed by keycode, so a key event goes straight to the binding for its
+      key.
+
+      Handlers are stored in an inplace_function, so a handler whose bound
+      arguments and captures fit in its buffer is added without allocating
+      beyond the growth of the tables. Key handlers share the buffer with
+      the adaptor that calls them, including the repeat rate limiter for key
+      down handlers. Larger handlers are allocated on the heap. A
+      function_ref may be passed instead for a handler that outlives the
+      map.
   */
   class event_map
   {
@@ -33,7 +83,7 @@ namespace sdl2
     template<class Function, class... Args>
     void add_key_down_handler(SDL_Keycode keycode, Function&& f, Args&&... args)
     {
-      handlers_.push_back(make_key_down_adaptor(keycode, std::bind(f, args...)));
+      add_key(SDL_KEYDOWN, keycode, make_key_down_adaptor(bind(std::forward<Function>(f), args...)));
     }
 
     /** Add a handler function to receive key up events.
@@ -43,7 +93,7 @@ namespace sdl2
     template<class Function, class... Args>
     void add_key_up_handler(SDL_Keycode keycode, Function&& f, Args&&... args)
     {
-      handlers_.push_back(make_key_up_adaptor(keycode, std::bind(f, args...)));
+      add_key(SDL_KEYUP, keycode, make_key_up_adaptor(bind(std::forward<Function>(f), args...)));
     }
 
     /** Add a handler function to conditionally handle events.
@@ -56,10 +106,8 @@ namespace sdl2
     template<class EventType, class Function, class... Args>
     void add_handler(EventType t, Function&& f, Args&&... args)
     {
-      handlers_.push_back(
-        std::make_pair(
-          static_cast<event_type>(t),
-          std::bind(f, args..., std::placeholders::_1)));
+      get_slot(static_cast<event_type>(t)).handlers.push_back(
+        entry{sequence_++, bind(std::forward<Function>(f), args...)});
     }
 
     /** Call the handler matching the event, if any.
@@ -71,115 +119,179 @@ namespace sdl2
     */
     bool handle_event(SDL_Event const& e)
     {
-      return std::find_if(handlers_.begin(),
-                          handlers_.end(),
-                          [&e](auto& candidate)
-                          {
-                            return (e.type == candidate.first &&
-                                    candidate.second(e));
-                          }) != handlers_.end();
+      auto s = find_slot(e.type);
+      if( s == nullptr )
+      {
+        return false;
+      }
+
+      // A key binding consumes its key's events, so only handlers added
+      // before the binding can see them
+      entry* binding = nullptr;
+      if( !s->keys.empty() )
+      {
+        auto k = s->keys.find(e.key.keysym.sym);
+        if( k != s->keys.end() )
+        {
+          binding = &k->second;
+        }
+      }
+      for( auto& h : s->handlers )
+      {
+        if( binding != nullptr && h.sequence > binding->sequence )
+        {
+          break;
+        }
+        if( h.f(e) )
+        {
+          return true;
+        }
+      }
+      return binding != nullptr && binding->f(e);
     }
 
   private:
     using event_type = unsigned int;
-    using handler = std::function<bool(SDL_Event const& e)>;
+    using handler = inplace_function<bool(SDL_Event const& e)>;
 
-    template<class Callable>
-    struct key_down_adaptor
+    // Copies f and args, like std::bind, into a callable that appends any
+    // further arguments
+    template<class Function, class... Args>
+    static auto bind(Function&& f, Args&&... args)
     {
-      key_down_adaptor(SDL_Keycode keycode, Callable handler)
-        : keycode_(keycode)
-        , handler_(std::move(handler))
+      return [f = std::forward<Function>(f), args...](auto&&... rest) mutable -> decltype(auto)
       {
-      }
+        return std::invoke(f, args..., std::forward<decltype(rest)>(rest)...);
+      };
+    }
 
-      bool operator()(SDL_Event const& e)
+    /** A handler and the order in which it was added */
+    struct entry
+    {
+      unsigned int sequence;
+      handler f;
+    };
+
+    /** The handlers for one event type, in the order they were added, and
+        the key bindings for the type by keycode
+    */
+    struct slot
+    {
+      event_type type;
+      std::vector<entry> handlers;
+      std::unordered_map<SDL_Keycode,entry> keys;
+    };
+
+    // SDL's built in event types lie below 0x2100, grouped in blocks of
+    // 0x100 with few members each. Indexing by block and the low
+    // five bits of the type keeps the table small. A type that shares an
+    // index with another is looked up in the map instead.
+    static constexpr event_type dense_blocks = 0x21;
+    static constexpr std::size_t no_slot = 0;
+
+    static std::size_t dense_index(event_type type)
+    {
+      return ((type >> 8) << 5) | (type & 0x1F);
+    }
+
+    slot* find_slot(event_type type)
+    {
+      if( (type >> 8) < dense_blocks )
       {
-        if(e.key.keysym.sym == keycode_)
+        auto i = dense_[dense_index(type)];
+        if( i != no_slot && slots_[i - 1].type == type )
         {
-          if(!rate_limited(e))
-          {
-            handler_();
-          }
-          return true;
+          return &slots_[i - 1];
         }
+      }
+      auto other = sparse_.find(type);
+      return other == sparse_.end() ? nullptr : &slots_[other->second];
+    }
 
-        return false;
+    slot& get_slot(event_type type)
+    {
+      if( auto s = find_slot(type) )
+      {
+        return *s;
       }
 
-    private:
-      bool rate_limited(SDL_Event const& e)
+      slots_.push_back(slot{type, {}, {}});
+      if( (type >> 8) < dense_blocks && dense_[dense_index(type)] == no_slot )
       {
-        if( e.key.repeat == 0 )
-        {
-          key_repeat_count_ = 0;
-        }
-        else
+        dense_[dense_index(type)] = static_cast<std::uint16_t>(slots_.size());
+      }
+      else
+      {
+        sparse_.emplace(type, slots_.size() - 1);
+      }
+      return slots_.back();
+    }
+
+    // Only the first binding for a key is kept, as any later one could
+    // never receive an event
+    template<class Callable>
+    void add_key(event_type type, SDL_Keycode keycode, Callable h)
+    {
+      get_slot(type).keys.emplace(keycode, entry{sequence_++, std::move(h)});
+    }
+
+    template<class Callable>
+    struct key_down_adaptor
+    {
+      explicit key_down_adaptor(Callable handler)
+        : handler_(std::move(handler))
+      {
+      }
+
+      bool operator()(SDL_Event const& e)
+      {
+        if(!limiter_.rate_limited(e))
         {
-          key_repeat_count_++;
+          handler_();
         }
-        auto last_key_timestamp = last_key_timestamp_;
-        last_key_timestamp_ = e.key.timestamp;
-
-        return (e.key.repeat != 0 &&
-                (e.key.timestamp - last_key_timestamp) <
-                (key_repeat_count_ > 0 ? 25 : 500));
+        return true;
       }
 
     private:
-      SDL_Keycode keycode_;
       Callable handler_;
-      unsigned int last_key_timestamp_ = 0;
-      unsigned int key_repeat_count_ = 0;
+      detail::key_repeat_limiter limiter_;
     };
 
     template<class Callable>
-    std::pair<event_type,key_down_adaptor<Callable>> make_key_down_adaptor(
-      SDL_Keycode keycode,
-      Callable handler)
+    key_down_adaptor<Callable> make_key_down_adaptor(Callable handler)
     {
-      return std::make_pair(
-        static_cast<event_type>(SDL_KEYDOWN),
-        key_down_adaptor<Callable>(keycode, std::move(handler)));
+      return key_down_adaptor<Callable>(std::move(handler));
     }
 
     template<class Callable>
     struct key_up_adaptor
     {
-      key_up_adaptor(SDL_Keycode keycode, Callable handler)
-        : keycode_(keycode)
-        , handler_(std::move(handler))
+      explicit key_up_adaptor(Callable handler)
+        : handler_(std::move(handler))
       {
       }
 
-      bool operator()(SDL_Event const& e)
+      bool operator()(SDL_Event const&)
       {
-        if( e.key.keysym.sym == keycode_)
-        {
-          handler_();
-          return true;
-        }
-
-        return false;
+        handler_();
+        return true;
       }
 
     private:
-      SDL_Keycode keycode_;
       Callable handler_;
     };
 
     template<class Callable>
-    std::pair<event_type,key_up_adaptor<Callable>> make_key_up_adaptor(
-      SDL_Keycode keycode,
-      Callable handler)
+    key_up_adaptor<Callable> make_key_up_adaptor(Callable handler)
     {
-      return std::make_pair(
-        static_cast<event_type>(SDL_KEYUP),
-        key_up_adaptor<Callable>(keycode, std::move(handler)));
+      return key_up_adaptor<Callable>(std::move(handler));
     }
 
   private:
-    std::vector<std::pair<event_type,handler>> handlers_;
+    std::vector<slot> slots_;
+    std::array<std::uint16_t, (dense_blocks << 5)> dense_{}; // One based
+    std::unordered_map<event_type,std::size_t> sparse_;
+    unsigned int sequence_ = 0;
   };
 } // namespace sdl2
 
@@ -0,0 +1,126 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_EVENT_PUMP_H
+#define SDL2_CPP_EVENT_PUMP_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <SDL2/SDL.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sdl2
+{
+  /** Counts and time for the events dispatched by an event_pump */
+  struct event_batch_stats
+  {
+    std::size_t events = 0;
+    std::size_t handled = 0;
+    std::size_t peeks = 0;
+    std::chrono::nanoseconds elapsed{0};
+
+    event_batch_stats& operator+=(event_batch_stats const& other)
+    {
+      events += other.events;
+      handled += other.handled;
+      peeks += other.peeks;
+      elapsed += other.elapsed;
+      return *this;
+    }
+  };
+
+  /** Drains SDL's event queue in bulk and dispatches the events to a map.
+
+      Each call to pump() takes queued events with SDL_PeepEvents, a buffer
+      at a time, rather than locking the queue once per event as
+      SDL_PollEvent does. The buffer is reused between calls.
+
+      EventMap may be an event_map or a static_event_map, or anything else
+      with a handle_event(SDL_Event const&) member. The map must outlive the
+      pump.
+  */
+  template<class EventMap>
+  class event_pump
+  {
+  public:
+    explicit event_pump(EventMap& map, std::size_t buffer_size = 256)
+      : map_(map)
+      , buffer_(std::max<std::size_t>(buffer_size, 1))
+    {
+    }
+
+    event_pump(event_pump const&) = delete;
+    void operator=(event_pump const&) = delete;
+
+    /** Gathers pending input and dispatches every queued event.
+
+        Returns the counts and time for this batch.
+    */
+    event_batch_stats const& pump()
+    {
+      auto start = std::chrono::steady_clock::now();
+      last_ = event_batch_stats();
+
+      SDL_PumpEvents();
+      int n = 0;
+      do
+      {
+        n = SDL_PeepEvents(buffer_.data(),
+                           static_cast<int>(buffer_.size()),
+                           SDL_GETEVENT,
+                           SDL_FIRSTEVENT,
+                           SDL_LASTEVENT);
+        if( n < 0 )
+        {
+          throw std::runtime_error(std::string("Failed to get events: ") + SDL_GetError());
+        }
+        ++last_.peeks;
+        last_.events += n;
+        for( int i = 0; i < n; ++i )
+        {
+          if( map_.handle_event(buffer_[i]) )
+          {
+            ++last_.handled;
+          }
+        }
+      } while( static_cast<std::size_t>(n) == buffer_.size() );
+
+      last_.elapsed = std::chrono::steady_clock::now() - start;
+      total_ += last_;
+      return last_;
+    }
+
+    /** Returns the counts and time for the most recent batch */
+    event_batch_stats const& last_batch() const
+    {
+      return last_;
+    }
+
+    /** Returns the counts and time for all batches since creation or the
+        last call to reset_stats()
+    */
+    event_batch_stats const& total() const
+    {
+      return total_;
+    }
+
+    void reset_stats()
+    {
+      last_ = event_batch_stats();
+      total_ = event_batch_stats();
+    }
+
+  private:
+    EventMap& map_;
+    std::vector<SDL_Event> buffer_;
+    event_batch_stats last_;
+    event_batch_stats total_;
+  };
+} // namespace sdl2
+
+#endif // SDL2_CPP_EVENT_PUMP_H
@@ -0,0 +1,126 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_FONT_FACE_H
+#define SDL2_CPP_FONT_FACE_H
+
+#include "ttf.h"
+
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** A font file mapped into memory once and shared by every point size
+        opened from it.
+
+        Fonts opened from a face read the mapping directly, without copying,
+        and keep it alive after the face itself is destroyed. Copies of a
+        face share the same mapping.
+    */
+    class font_face
+    {
+    public:
+      /** Maps the specified font file, throwing std::runtime_error on failure */
+      explicit font_face(std::string const& path)
+        : mapping_(std::make_shared<mapping const>(path))
+      {
+      }
+
+      /** Opens the face at the specified point size. For a font collection
+          file, index selects the face within it.
+
+          The font is owned by the returned shared_ptr.
+      */
+      font open(int point_size, long index = 0) const
+      {
+        TTF_Font* f = nullptr;
+        {
+          std::lock_guard<std::mutex> lock(library_mutex());
+          auto rw = SDL_RWFromConstMem(data(), static_cast<int>(size()));
+          if( rw == nullptr )
+          {
+            return font();
+          }
+          detail::timed_op timed(detail::counters().font_opens);
+          f = TTF_OpenFontIndexRW(rw, 1, point_size, index);
+        }
+        if( f == nullptr )
+        {
+          return font();
+        }
+        auto m = mapping_;
+        return font(f, [m](TTF_Font* p) { close_font(p); });
+      }
+
+      std::string const& path() const
+      {
+        return mapping_->path;
+      }
+
+      Uint8 const* data() const
+      {
+        return static_cast<Uint8 const*>(mapping_->data);
+      }
+
+      std::size_t size() const
+      {
+        return mapping_->size;
+      }
+
+    private:
+      struct mapping
+      {
+        explicit mapping(std::string const& file)
+          : path(file)
+        {
+          int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+          if( fd < 0 )
+          {
+            throw std::runtime_error("Failed to open font file: " + path);
+          }
+          struct stat st;
+          if( ::fstat(fd, &st) == 0 && st.st_size > 0 )
+          {
+            size = static_cast<std::size_t>(st.st_size);
+            data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+          }
+          ::close(fd);
+          if( data == MAP_FAILED || data == nullptr )
+          {
+            throw std::runtime_error("Failed to map font file: " + path);
+          }
+        }
+
+        ~mapping()
+        {
+          ::munmap(data, size);
+        }
+
+        mapping(mapping const&) = delete;
+        void operator=(mapping const&) = delete;
+
+        std::string path;
+        void* data = nullptr;
+        std::size_t size = 0;
+      };
+
+      std::shared_ptr<mapping const> mapping_;
+    };
+
+    /** Maps the file best matching a font name */
+    inline font_face open_face(std::string const& font_name)
+    {
+      return font_face(resolve_font(font_name));
+    }
+  }
+}
+
+#endif // SDL2_CPP_FONT_FACE_H
@@ -0,0 +1,237 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_FONT_FALLBACK_H
+#define SDL2_CPP_FONT_FALLBACK_H
+
+#include "font_face.h"
+#include "ttf.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** The set of code points a font file provides, as a two level bitmap
+        built from its fontconfig charset
+    */
+    class font_coverage
+    {
+    public:
+      explicit font_coverage(FcCharSet const* charset)
+        : pages_(page_count, -1)
+      {
+        FcChar32 map[FC_CHARSET_MAP_SIZE];
+        FcChar32 next = 0;
+        auto cs = const_cast<FcCharSet*>(charset);
+        for( auto base = FcCharSetFirstPage(cs, map, &next);
+             base != FC_CHARSET_DONE && (base >> 8) < page_count;
+             base = FcCharSetNextPage(cs, map, &next) )
+        {
+          block b;
+          for( int i = 0; i < FC_CHARSET_MAP_SIZE; ++i )
+          {
+            b[i] = map[i];
+          }
+          pages_[base >> 8] = static_cast<int>(blocks_.size());
+          blocks_.push_back(b);
+        }
+      }
+
+      bool has(Uint32 code_point) const
+      {
+        auto page = code_point >> 8;
+        if( page >= page_count || pages_[page] < 0 )
+        {
+          return false;
+        }
+        auto& b = blocks_[pages_[page]];
+        return (b[(code_point & 0xFF) >> 5] >> (code_point & 0x1F)) & 1;
+      }
+
+      /** Returns true if any code point in a 256 code point page is covered */
+      bool has_page(Uint32 page) const
+      {
+        return page < page_count && pages_[page] >= 0;
+      }
+
+      static constexpr Uint32 page_count = 0x110000 >> 8;
+
+    private:
+      using block = std::array<Uint32, 8>;
+
+      std::vector<int> pages_;
+      std::vector<block> blocks_;
+    };
+
+    /** A chain of fonts to draw text with, falling back from the best match
+        for a font name to fonts covering code points it lacks.
+
+        The chain is built once with FcFontSort and the coverage of its faces
+        is merged into a table of the first face covering each code point, so
+        choosing the font for a code point is a single lookup and never
+        probes FreeType. Fonts are opened at the chain's point size when
+        first used.
+
+        Throws std::runtime_error if fontconfig finds no font for the name.
+    */
+    class fallback_chain
+    {
+    public:
+      fallback_chain(std::string const& font_name, int point_size, std::size_t max_faces = 8)
+        : point_size_(point_size)
+        , pages_(font_coverage::page_count, -1)
+      {
+        // Face indices are stored in a byte per code point
+        max_faces = std::min<std::size_t>(max_faces, 256);
+        std::vector<font_coverage> coverage;
+        auto add = [this, max_faces, &coverage](char const* file,
+                                                int index,
+                                                FcCharSet const* charset)
+        {
+          if( links_.size() < max_faces )
+          {
+            links_.push_back(link{file, index, font()});
+            coverage.emplace_back(charset);
+          }
+        };
+        if( auto resolver = lib::resolver() )
+        {
+          resolver->sort(font_name, add);
+        }
+        else
+        {
+          font_resolver().sort(font_name, add);
+        }
+        if( links_.empty() )
+        {
+          throw std::runtime_error("No fonts found for " + font_name);
+        }
+        merge(coverage);
+      }
+
+      fallback_chain(fallback_chain const&) = delete;
+      void operator=(fallback_chain const&) = delete;
+
+      /** Returns the number of fonts in the chain */
+      std::size_t size() const
+      {
+        return links_.size();
+      }
+
+      /** Returns the index of the first font covering a code point, or 0 if
+          none does
+      */
+      std::size_t index_for(Uint32 code_point) const
+      {
+        auto page = code_point >> 8;
+        if( page >= font_coverage::page_count || pages_[page] < 0 )
+        {
+          return 0;
+        }
+        return blocks_[pages_[page]][code_point & 0xFF];
+      }
+
+      /** Returns the font at the specified index, opening it if necessary */
+      font const& get_font(std::size_t index)
+      {
+        auto& l = links_.at(index);
+        if( !l.f )
+        {
+          l.f = font_face(l.file).open(point_size_, l.index);
+        }
+        return l.f;
+      }
+
+      /** Returns the font to draw a code point with */
+      font const& font_for(Uint32 code_point)
+      {
+        return get_font(index_for(code_point));
+      }
+
+      /** Splits a UTF-8 string into runs drawn with the same font and calls
+          f(run, font) for each run in order
+      */
+      template<class Function>
+      void for_each_run(std::string_view text, Function&& f)
+      {
+        std::size_t run_start = 0;
+        std::size_t run_index = 0;
+        std::size_t pos = 0;
+        while( pos < text.size() )
+        {
+          auto start = pos;
+          auto index = index_for(next_code_point(text, pos));
+          if( index != run_index && start != run_start )
+          {
+            f(text.substr(run_start, start - run_start), get_font(run_index));
+            run_start = start;
+          }
+          run_index = index;
+        }
+        if( run_start < text.size() )
+        {
+          f(text.substr(run_start), get_font(run_index));
+        }
+      }
+
+    private:
+      struct link
+      {
+        std::string file;
+        int index;
+        font f;
+      };
+
+      // Builds the first covering face of each code point, for pages that
+      // any face covers
+      void merge(std::vector<font_coverage> const& coverage)
+      {
+        for( Uint32 page = 0; page < font_coverage::page_count; ++page )
+        {
+          bool covered = false;
+          for( auto& c : coverage )
+          {
+            covered = covered || c.has_page(page);
+          }
+          if( !covered )
+          {
+            continue;
+          }
+
+          block b{};
+          for( Uint32 i = 0; i < 256; ++i )
+          {
+            auto code_point = (page << 8) | i;
+            for( std::size_t face = 0; face < coverage.size(); ++face )
+            {
+              if( coverage[face].has(code_point) )
+              {
+                b[i] = static_cast<Uint8>(face);
+                break;
+              }
+            }
+          }
+          pages_[page] = static_cast<int>(blocks_.size());
+          blocks_.push_back(b);
+        }
+      }
+
+      using block = std::array<Uint8, 256>;
+
+      int point_size_;
+      std::vector<link> links_;
+      std::vector<int> pages_;
+      std::vector<block> blocks_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_FONT_FALLBACK_H
@@ -0,0 +1,183 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_FONT_LOADER_H
+#define SDL2_CPP_FONT_LOADER_H
+
+#include "font_face.h"
+#include "font_registry.h"
+#include "ttf.h"
+
+#include <future>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** A font opened off the render thread, with any glyphs rendered ahead
+        of use.
+
+        The glyphs can be uploaded with glyph_atlas::insert on the render
+        thread.
+    */
+    struct loaded_font
+    {
+      font f;
+      std::vector<glyph_bitmap> glyphs;
+    };
+
+    /** Renders each distinct code point of the specified UTF-8 string */
+    inline std::vector<glyph_bitmap> render_glyphs(font const& f, std::string_view chars)
+    {
+      std::vector<glyph_bitmap> glyphs;
+      std::unordered_set<Uint32> seen;
+      std::size_t pos = 0;
+      while( pos < chars.size() )
+      {
+        auto cp = next_code_point(chars, pos);
+        if( seen.insert(cp).second )
+        {
+          glyphs.push_back(render_glyph(f, cp));
+        }
+      }
+      return glyphs;
+    }
+
+    namespace detail
+    {
+      /** Releases the calling thread's fonts from a registry on leaving scope */
+      struct thread_fonts_guard
+      {
+        font_registry& registry;
+
+        ~thread_fonts_guard()
+        {
+          registry.release_thread();
+        }
+      };
+    }
+
+    /** Resolves and opens a font on a worker thread, then renders the glyphs
+        of prewarm with it.
+
+        The font is not shared with any other thread until the future is
+        ready. Errors opening the font are reported through the future.
+    */
+    inline std::future<loaded_font> open_font_async(std::string font_name,
+                                                    int point_size,
+                                                    std::string prewarm = std::string())
+    {
+      return std::async(
+        std::launch::async,
+        [font_name = std::move(font_name), point_size, prewarm = std::move(prewarm)]()
+        {
+          loaded_font loaded;
+          loaded.f = open_face(font_name).open(point_size);
+          if( !loaded.f )
+          {
+            throw_error("Failed to open font " + font_name + ": ");
+          }
+          loaded.glyphs = render_glyphs(loaded.f, prewarm);
+          return loaded;
+        });
+    }
+
+    /** Gets a font from a registry on a worker thread, and renders the
+        glyphs of prewarm with a private instance of it.
+
+        Registry fonts may be shared with other threads, so the glyphs are
+        rendered with the worker's own instance from get_local rather than
+        with the returned font. The registry must outlive the future.
+    */
+    inline std::future<loaded_font> open_font_async(font_registry& registry,
+                                                    font_registry::key k,
+                                                    std::string prewarm = std::string())
+    {
+      return std::async(
+        std::launch::async,
+        [&registry, k = std::move(k), prewarm = std::move(prewarm)]()
+        {
+          loaded_font loaded;
+          loaded.f = registry.get(k);
+          if( !loaded.f )
+          {
+            throw_error("Failed to open font " + k.pattern + ": ");
+          }
+          if( !prewarm.empty() )
+          {
+            detail::thread_fonts_guard guard{registry};
+            auto local = registry.get_local(k);
+            if( !local )
+            {
+              throw_error("Failed to open font " + k.pattern + ": ");
+            }
+            loaded.glyphs = render_glyphs(local, prewarm);
+          }
+          return loaded;
+        });
+    }
+
+    /** Renders each distinct code point of the specified UTF-8 string using
+        up to the specified number of worker threads, each with its own
+        instance of the font from the registry.
+
+        The glyphs are returned in the order their code points first appear.
+        Throws std::runtime_error if a worker cannot open its instance of the
+        font.
+    */
+    inline std::vector<glyph_bitmap> render_glyphs_parallel(font_registry& registry,
+                                                            font_registry::key const& k,
+                                                            std::string_view chars,
+                                                            unsigned int threads)
+    {
+      std::vector<Uint32> code_points;
+      std::unordered_set<Uint32> seen;
+      std::size_t pos = 0;
+      while( pos < chars.size() )
+      {
+        auto cp = next_code_point(chars, pos);
+        if( seen.insert(cp).second )
+        {
+          code_points.push_back(cp);
+        }
+      }
+
+      std::vector<glyph_bitmap> glyphs(code_points.size());
+      threads = std::max(1u, std::min<unsigned int>(threads, code_points.size()));
+      std::size_t chunk = (code_points.size() + threads - 1) / threads;
+      std::vector<std::future<void>> workers;
+      for( std::size_t begin = 0; begin < code_points.size(); begin += chunk )
+      {
+        auto end = std::min(begin + chunk, code_points.size());
+        workers.push_back(std::async(
+          std::launch::async,
+          [&registry, &k, &code_points, &glyphs, begin, end]()
+          {
+            detail::thread_fonts_guard guard{registry};
+            auto f = registry.get_local(k);
+            if( !f )
+            {
+              throw_error("Failed to open font " + k.pattern + ": ");
+            }
+            for( auto i = begin; i < end; ++i )
+            {
+              glyphs[i] = render_glyph(f, code_points[i]);
+            }
+          }));
+      }
+      for( auto& w : workers )
+      {
+        w.get();
+      }
+      return glyphs;
+    }
+  }
+}
+
+#endif // SDL2_CPP_FONT_LOADER_H
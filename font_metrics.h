@@ -0,0 +1,408 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_FONT_METRICS_H
+#define SDL2_CPP_FONT_METRICS_H
+
+#include "ttf.h"
+
+#include <array>
+#include <climits>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** Caches the glyph metrics and kerning of a font for text measurement.
+
+        Metrics are fetched from the font the first time each glyph or
+        kerning pair is seen. Once the glyphs of a string have been seen,
+        measuring it again neither queries FreeType nor allocates.
+
+        The metrics reflect the font's style, outline and kerning setting at
+        the time they are fetched, so changing them requires a new
+        font_metrics.
+    */
+    class font_metrics
+    {
+    public:
+      /** Advance and horizontal extent of a glyph */
+      struct glyph
+      {
+        int advance;
+        int minx;
+        int maxx;
+      };
+
+      explicit font_metrics(font f)
+        : font_(std::move(f))
+        , ascent_(TTF_FontAscent(font_.get()))
+        , descent_(TTF_FontDescent(font_.get()))
+        , height_(TTF_FontHeight(font_.get()))
+        , line_skip_(TTF_FontLineSkip(font_.get()))
+        , kerning_(TTF_GetFontKerning(font_.get()) != 0)
+      {
+        for( Uint32 cp = 0; cp < ascii_.size(); ++cp )
+        {
+          ascii_[cp] = fetch(cp);
+          if( cp >= first_printable && cp <= last_printable )
+          {
+            auto& g = ascii_[cp];
+            printable_min_advance_ = std::min(printable_min_advance_, g.advance);
+            printable_max_overhang_ = std::max({printable_max_overhang_,
+                                                -g.minx,
+                                                g.maxx - g.advance});
+          }
+        }
+        if( kerning_ )
+        {
+          ascii_kerning_.assign(ascii_.size() * ascii_.size(), unknown_kerning);
+        }
+      }
+
+      font const& get_font() const
+      {
+        return font_;
+      }
+
+      int ascent() const
+      {
+        return ascent_;
+      }
+
+      int descent() const
+      {
+        return descent_;
+      }
+
+      int height() const
+      {
+        return height_;
+      }
+
+      int line_skip() const
+      {
+        return line_skip_;
+      }
+
+      /** Returns the metrics of the glyph for a code point */
+      glyph const& get(Uint32 code_point)
+      {
+        if( code_point < ascii_.size() )
+        {
+          return ascii_[code_point];
+        }
+        auto cached = glyphs_.find(code_point);
+        if( cached == glyphs_.end() )
+        {
+          cached = glyphs_.emplace(code_point, fetch(code_point)).first;
+        }
+        return cached->second;
+      }
+
+      /** Returns the advance in pixels of the glyph for a code point */
+      int advance(Uint32 code_point)
+      {
+        return get(code_point).advance;
+      }
+
+      /** Returns the kerning adjustment in pixels between two code points,
+          or 0 if kerning is disabled for the font
+      */
+      int kerning(Uint32 previous, Uint32 code_point)
+      {
+        if( !kerning_ )
+        {
+          return 0;
+        }
+
+        if( previous < ascii_.size() && code_point < ascii_.size() )
+        {
+          return ascii_kerning(previous, code_point);
+        }
+
+        auto pair = (static_cast<Uint64>(previous) << 32) | code_point;
+        auto cached = kerning_pairs_.find(pair);
+        if( cached == kerning_pairs_.end() )
+        {
+          cached = kerning_pairs_.emplace(
+            pair,
+            TTF_GetFontKerningSizeGlyphs32(font_.get(), previous, code_point)).first;
+        }
+        return cached->second;
+      }
+
+      /** Returns the width in pixels of the specified UTF-8 string, using the
+          same extent rules as TTF_SizeUTF8
+      */
+      int measure(std::string_view text)
+      {
+        if( is_ascii(text) )
+        {
+          return measure_ascii(text);
+        }
+
+        int x = 0;
+        int minx = 0;
+        int maxx = 0;
+        Uint32 previous = 0;
+        std::size_t pos = 0;
+        while( pos < text.size() )
+        {
+          auto cp = next_code_point(text, pos);
+          if( previous != 0 )
+          {
+            x += kerning(previous, cp);
+          }
+          auto& g = get(cp);
+          minx = std::min(minx, x + g.minx);
+          x += g.advance;
+          maxx = std::max(maxx, x + std::max(0, g.maxx - g.advance));
+          previous = cp;
+        }
+        return maxx - minx;
+      }
+
+      /** Returns how far in pixels the ink of the specified UTF-8 string
+          extends left of the starting pen position, or 0 if it does not
+      */
+      int left_overhang(std::string_view text)
+      {
+        int x = 0;
+        int minx = 0;
+        Uint32 previous = 0;
+        std::size_t pos = 0;
+        while( pos < text.size() )
+        {
+          auto cp = next_code_point(text, pos);
+          if( previous != 0 )
+          {
+            x += kerning(previous, cp);
+          }
+          auto& g = get(cp);
+          minx = std::min(minx, x + g.minx);
+          x += g.advance;
+          previous = cp;
+        }
+        return -minx;
+      }
+
+      /** Measures count strings in one call, writing their widths and heights
+          to the corresponding elements of widths and heights, either of which
+          may be null
+      */
+      void measure(std::string_view const* texts, std::size_t count, int* widths, int* heights)
+      {
+        for( std::size_t i = 0; i < count; ++i )
+        {
+          if( widths != nullptr )
+          {
+            widths[i] = measure(texts[i]);
+          }
+          if( heights != nullptr )
+          {
+            heights[i] = height_;
+          }
+        }
+      }
+
+      /** Fetches the metrics of every glyph and adjacent pair in the
+          specified UTF-8 string, so later measurement does not query the font
+      */
+      void warm(std::string_view text)
+      {
+        Uint32 previous = 0;
+        std::size_t pos = 0;
+        while( pos < text.size() )
+        {
+          auto cp = next_code_point(text, pos);
+          get(cp);
+          if( previous != 0 )
+          {
+            kerning(previous, cp);
+          }
+          previous = cp;
+        }
+      }
+
+    private:
+      static constexpr short unknown_kerning = SHRT_MIN;
+      static constexpr Uint32 first_printable = 0x20;
+      static constexpr Uint32 last_printable = 0x7E;
+
+      int ascii_kerning(unsigned char previous, unsigned char code_point)
+      {
+        auto& k = ascii_kerning_[previous * ascii_.size() + code_point];
+        if( k == unknown_kerning )
+        {
+          k = static_cast<short>(
+            TTF_GetFontKerningSizeGlyphs32(font_.get(), previous, code_point));
+          min_ascii_kerning_ = std::min<int>(min_ascii_kerning_, k);
+        }
+        return k;
+      }
+
+      static unsigned int is_unprintable(unsigned char c)
+      {
+        return static_cast<unsigned int>(c - first_printable) > last_printable - first_printable;
+      }
+
+      // Kerning and advance of an ASCII glyph following previous, or
+      // following nothing if previous is 0
+      int ascii_step(unsigned char previous, unsigned char code_point)
+      {
+        int k = (kerning_ && previous != 0) ? ascii_kerning(previous, code_point) : 0;
+        return k + ascii_[code_point].advance;
+      }
+
+      static bool is_ascii(std::string_view text)
+      {
+        // Test eight bytes at a time for a set top bit
+        std::size_t i = 0;
+        for( ; i + 8 <= text.size(); i += 8 )
+        {
+          Uint64 word;
+          std::memcpy(&word, text.data() + i, 8);
+          if( word & 0x8080808080808080ull )
+          {
+            return false;
+          }
+        }
+        for( ; i < text.size(); ++i )
+        {
+          if( text[i] & 0x80 )
+          {
+            return false;
+          }
+        }
+        return true;
+      }
+
+      int measure_ascii(std::string_view text)
+      {
+        auto bytes = reinterpret_cast<unsigned char const*>(text.data());
+        auto n = text.size();
+        if( n == 0 )
+        {
+          return 0;
+        }
+
+        // Sum the advances and kerning in independent chains, noting any
+        // character outside the printable range
+        int a0 = ascii_step(0, bytes[0]);
+        int a1 = 0;
+        int a2 = 0;
+        int a3 = 0;
+        unsigned int unprintable = 0;
+        std::size_t i = 1;
+        for( ; i + 4 <= n; i += 4 )
+        {
+          a0 += ascii_step(bytes[i - 1], bytes[i]);
+          a1 += ascii_step(bytes[i], bytes[i + 1]);
+          a2 += ascii_step(bytes[i + 1], bytes[i + 2]);
+          a3 += ascii_step(bytes[i + 2], bytes[i + 3]);
+          unprintable |= (is_unprintable(bytes[i]) |
+                          is_unprintable(bytes[i + 1]) |
+                          is_unprintable(bytes[i + 2]) |
+                          is_unprintable(bytes[i + 3]));
+        }
+        for( ; i < n; ++i )
+        {
+          a0 += ascii_step(bytes[i - 1], bytes[i]);
+          unprintable |= is_unprintable(bytes[i]);
+        }
+        unprintable |= is_unprintable(bytes[0]);
+        int x = a0 + a1 + a2 + a3;
+
+        // When every step moves the pen further than any glyph overhangs,
+        // no glyph but the first can extend left of the start and none but
+        // the last can extend right of the end, so the extent only depends
+        // on those two
+        int min_step = printable_min_advance_ + (kerning_ ? std::min(0, min_ascii_kerning_) : 0);
+        if( unprintable == 0 &&
+            min_step >= printable_max_overhang_ )
+        {
+          auto& first = ascii_[bytes[0]];
+          auto& last = ascii_[bytes[n - 1]];
+          int minx = std::min(0, first.minx);
+          int maxx = std::max(0, x + std::max(0, last.maxx - last.advance));
+          return maxx - minx;
+        }
+
+        x = 0;
+        int minx = 0;
+        int maxx = 0;
+        unsigned char previous = 0;
+        for( i = 0; i < n; ++i )
+        {
+          auto cp = bytes[i];
+          if( previous != 0 )
+          {
+            x += kerning(previous, cp);
+          }
+          auto& g = ascii_[cp];
+          minx = std::min(minx, x + g.minx);
+          x += g.advance;
+          maxx = std::max(maxx, x + std::max(0, g.maxx - g.advance));
+          previous = cp;
+        }
+        return maxx - minx;
+      }
+
+      glyph fetch(Uint32 code_point)
+      {
+        glyph g{0, 0, 0};
+        int miny = 0;
+        int maxy = 0;
+        TTF_GlyphMetrics32(font_.get(), code_point, &g.minx, &g.maxx, &miny, &maxy, &g.advance);
+        return g;
+      }
+
+    private:
+      font font_;
+      int ascent_;
+      int descent_;
+      int height_;
+      int line_skip_;
+      bool kerning_;
+      std::array<glyph, 128> ascii_;
+      int printable_min_advance_ = INT_MAX;
+      int printable_max_overhang_ = 0;
+      int min_ascii_kerning_ = 0;
+      std::vector<short> ascii_kerning_;
+      std::unordered_map<Uint32, glyph> glyphs_;
+      std::unordered_map<Uint64, int> kerning_pairs_;
+    };
+
+    /** Gets the size in pixels of the specified string using cached metrics */
+    inline void size(font_metrics& m, std::string_view text, int* w, int* h)
+    {
+      if( w != nullptr )
+      {
+        *w = m.measure(text);
+      }
+      if( h != nullptr )
+      {
+        *h = m.height();
+      }
+    }
+
+    /** Gets the sizes in pixels of count strings using cached metrics */
+    inline void size(font_metrics& m,
+                     std::string_view const* texts,
+                     std::size_t count,
+                     int* widths,
+                     int* heights)
+    {
+      m.measure(texts, count, widths, heights);
+    }
+  }
+}
+
+#endif // SDL2_CPP_FONT_METRICS_H
@@ -0,0 +1,300 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_FONT_REGISTRY_H
+#define SDL2_CPP_FONT_REGISTRY_H
+
+#include "font_face.h"
+#include "ttf.h"
+
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** Thread safe registry of open fonts.
+
+        Fonts are keyed by fontconfig pattern, point size, style and hinting.
+        While any caller holds a font, requests for the same key share it.
+        Concurrent requests for a key that is being opened wait for that open
+        rather than opening a second copy.
+
+        Each font file is mapped once as a font_face and every size opened
+        from it shares the mapping.
+
+        Fonts are opened and closed under library_mutex, so the registry may be
+        used from loader threads. The fonts returned by get are still not safe
+        to render with from more than one thread at a time; get_local returns
+        a separate instance for each thread so rendering can be spread across
+        threads.
+    */
+    class font_registry
+    {
+    public:
+      struct key
+      {
+        std::string pattern;
+        int point_size;
+        int style = TTF_STYLE_NORMAL;
+        int hinting = TTF_HINTING_NORMAL;
+
+        bool operator==(key const& other) const
+        {
+          return (point_size == other.point_size &&
+                  style == other.style &&
+                  hinting == other.hinting &&
+                  pattern == other.pattern);
+        }
+      };
+
+      font_registry() = default;
+      font_registry(font_registry const&) = delete;
+      void operator=(font_registry const&) = delete;
+
+      /** Returns the font for the specified key, opening it if no caller
+          currently holds it.
+
+          Throws std::runtime_error if the font file cannot be mapped and
+          returns an empty font if SDL_ttf cannot open it.
+      */
+      font get(key const& k)
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto& e = entries_[k];
+        if( auto f = e.cached.lock() )
+        {
+          return f;
+        }
+        if( e.pending.valid() )
+        {
+          auto pending = e.pending;
+          lock.unlock();
+          return pending.get();
+        }
+
+        std::promise<font> opened;
+        e.pending = opened.get_future().share();
+        lock.unlock();
+
+        font f;
+        std::string path;
+        try
+        {
+          path = resolve_font(k.pattern);
+          f = open(face(path), k);
+        }
+        catch( ... )
+        {
+          lock.lock();
+          entries_.erase(k);
+          opened.set_exception(std::current_exception());
+          throw;
+        }
+
+        lock.lock();
+        if( f )
+        {
+          auto& opened_entry = entries_[k];
+          opened_entry.cached = f;
+          opened_entry.path = path;
+          opened_entry.pending = std::shared_future<font>();
+        }
+        else
+        {
+          entries_.erase(k);
+        }
+        opened.set_value(f);
+        return f;
+      }
+
+      font get(std::string const& pattern,
+               int point_size,
+               int style = TTF_STYLE_NORMAL,
+               int hinting = TTF_HINTING_NORMAL)
+      {
+        return get(key{pattern, point_size, style, hinting});
+      }
+
+      /** Returns an instance of the font for the specified key owned by the
+          calling thread, opening it over the shared font file if the thread
+          has none.
+
+          The registry keeps the instance until the thread calls
+          release_thread.
+      */
+      font get_local(key const& k)
+      {
+        local_key lk{k, std::this_thread::get_id()};
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          auto existing = locals_.find(lk);
+          if( existing != locals_.end() )
+          {
+            return existing->second.f;
+          }
+        }
+
+        auto path = resolve_font(k.pattern);
+        auto f = open(face(path), k);
+        if( f )
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          locals_.emplace(std::move(lk), local{f, path});
+        }
+        return f;
+      }
+
+      /** Releases the registry's references to the calling thread's fonts */
+      void release_thread()
+      {
+        auto id = std::this_thread::get_id();
+        std::vector<font> released;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for( auto i = locals_.begin(); i != locals_.end(); )
+        {
+          if( i->first.thread == id )
+          {
+            released.push_back(std::move(i->second.f));
+            i = locals_.erase(i);
+          }
+          else
+          {
+            ++i;
+          }
+        }
+      }
+
+      /** Removes entries for fonts that are no longer held by any caller
+          and releases the registry's reference to their font files
+      */
+      void purge()
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::unordered_map<std::string, font_face> live_faces;
+        for( auto i = entries_.begin(); i != entries_.end(); )
+        {
+          if( !i->second.pending.valid() && i->second.cached.expired() )
+          {
+            i = entries_.erase(i);
+          }
+          else
+          {
+            auto face = faces_.find(i->second.path);
+            if( face != faces_.end() )
+            {
+              live_faces.emplace(*face);
+            }
+            ++i;
+          }
+        }
+        for( auto& local : locals_ )
+        {
+          auto face = faces_.find(local.second.path);
+          if( face != faces_.end() )
+          {
+            live_faces.emplace(*face);
+          }
+        }
+        faces_.swap(live_faces);
+      }
+
+      /** Returns the number of fonts currently held through the registry */
+      std::size_t size() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::size_t n = 0;
+        for( auto& e : entries_ )
+        {
+          n += e.second.cached.expired() ? 0 : 1;
+        }
+        return n;
+      }
+
+    private:
+      struct key_hash
+      {
+        std::size_t operator()(key const& k) const
+        {
+          auto h = std::hash<std::string>()(k.pattern);
+          for( int v : {k.point_size, k.style, k.hinting} )
+          {
+            h ^= std::hash<int>()(v) + 0x9e3779b9 + (h << 6) + (h >> 2);
+          }
+          return h;
+        }
+      };
+
+      struct local_key
+      {
+        key k;
+        std::thread::id thread;
+
+        bool operator==(local_key const& other) const
+        {
+          return thread == other.thread && k == other.k;
+        }
+      };
+
+      struct local_key_hash
+      {
+        std::size_t operator()(local_key const& lk) const
+        {
+          auto h = key_hash()(lk.k);
+          return h ^ (std::hash<std::thread::id>()(lk.thread) + 0x9e3779b9 + (h << 6) + (h >> 2));
+        }
+      };
+
+      struct local
+      {
+        font f;
+        std::string path;
+      };
+
+      struct entry
+      {
+        font_cache cached;
+        std::shared_future<font> pending;
+        std::string path;
+      };
+
+      font_face face(std::string const& path)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto existing = faces_.find(path);
+        if( existing != faces_.end() )
+        {
+          return existing->second;
+        }
+        return faces_.emplace(path, font_face(path)).first->second;
+      }
+
+      static font open(font_face const& face, key const& k)
+      {
+        auto f = face.open(k.point_size);
+        if( f )
+        {
+          TTF_SetFontStyle(f.get(), k.style);
+          TTF_SetFontHinting(f.get(), k.hinting);
+        }
+        return f;
+      }
+
+    private:
+      mutable std::mutex mutex_;
+      std::unordered_map<key, entry, key_hash> entries_;
+      std::unordered_map<local_key, local, local_key_hash> locals_;
+      std::unordered_map<std::string, font_face> faces_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_FONT_REGISTRY_H
@@ -0,0 +1,268 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_GLYPH_ATLAS_H
+#define SDL2_CPP_GLYPH_ATLAS_H
+
+#include "font_metrics.h"
+#include "ttf.h"
+
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** Draws text from glyphs cached in a single streaming texture.
+
+        Each glyph of the font is rasterized once, on first use, and packed
+        into the atlas texture. Text added to the atlas is queued as textured
+        quads and drawn with a single SDL_RenderGeometry call by render(), so
+        changing strings never cause a surface or texture to be created.
+
+        The renderer must outlive the atlas.
+    */
+    class glyph_atlas
+    {
+    public:
+      /** Location of a cached glyph within the atlas texture */
+      struct glyph
+      {
+        SDL_Rect rect;
+        int x_offset;
+        int y_offset;
+        int advance;
+      };
+
+      glyph_atlas(renderer const& r, font f, int width = 1024, int height = 1024)
+        : r_(r)
+        , font_(std::move(f))
+        , texture_(SDL_CreateTexture(r.get(),
+                                     SDL_PIXELFORMAT_ARGB8888,
+                                     SDL_TEXTUREACCESS_STREAMING,
+                                     width,
+                                     height),
+                   SDL_DestroyTexture)
+        , width_(width)
+        , height_(height)
+        , metrics_(font_)
+      {
+        if( !texture_ )
+        {
+          sdl::throw_error("Failed to create glyph atlas texture: ");
+        }
+        SDL_SetTextureBlendMode(texture_.get(), SDL_BLENDMODE_BLEND);
+        clear_texture();
+      }
+
+      glyph_atlas(glyph_atlas const&) = delete;
+      void operator=(glyph_atlas const&) = delete;
+
+      /** Returns the font whose glyphs are cached */
+      font const& get_font() const
+      {
+        return font_;
+      }
+
+      /** Returns the cached metrics of the font */
+      font_metrics& metrics()
+      {
+        return metrics_;
+      }
+
+      /** Returns the cached glyph for a code point, rasterizing it first if
+          necessary.
+
+          The returned pointer is invalidated if the atlas fills up and is
+          cleared to make room.
+      */
+      glyph const* find(Uint32 code_point)
+      {
+        return find(code_point, [this, code_point]() { return render_glyph(font_, code_point); });
+      }
+
+      /** Returns the cached glyph for a key, calling render() to produce its
+          bitmap first if necessary.
+
+          Keys below 2^32 are code points of the atlas's font. Higher keys are
+          available for glyphs cached by other means, such as the glyph
+          indices of shaped text.
+      */
+      template<class Render>
+      glyph const* find(Uint64 key, Render&& render)
+      {
+        auto cached = glyphs_.find(key);
+        if( cached != glyphs_.end() )
+        {
+          return &cached->second;
+        }
+        return insert(key, render());
+      }
+
+      /** Queues the specified UTF-8 string with the top left of the line at
+          (x, y).
+
+          Returns the pen position following the last glyph.
+      */
+      float add(std::string_view text, float x, float y, SDL_Color const& c)
+      {
+        Uint32 previous = 0;
+        std::size_t pos = 0;
+        while( pos < text.size() )
+        {
+          auto cp = next_code_point(text, pos);
+          if( previous != 0 )
+          {
+            x += metrics_.kerning(previous, cp);
+          }
+          auto g = find(cp);
+          add(*g, x, y, c);
+          x += g->advance;
+          previous = cp;
+        }
+        return x;
+      }
+
+      /** Queues a single cached glyph with the pen at (x, y) */
+      void add(glyph const& g, float x, float y, SDL_Color const& c)
+      {
+        if( g.rect.w == 0 )
+        {
+          return;
+        }
+
+        quads_.add(g.rect, width_, height_, x + g.x_offset, y + g.y_offset, c);
+      }
+
+      /** Draws all queued text and empties the queue */
+      void render()
+      {
+        quads_.render(r_, texture_);
+      }
+
+      /** Queues and immediately draws the specified UTF-8 string */
+      float draw(std::string_view text, float x, float y, SDL_Color const& c)
+      {
+        x = add(text, x, y, c);
+        render();
+        return x;
+      }
+
+      /** Discards all cached glyphs */
+      void clear()
+      {
+        render();
+        glyphs_.clear();
+        clear_texture();
+        shelf_x_ = 0;
+        shelf_y_ = 0;
+        shelf_height_ = 0;
+      }
+
+      /** Uploads a glyph rendered ahead of use, e.g. by open_font_async.
+
+          The glyph must have been rendered from the atlas's font. If the
+          code point is already cached, the existing glyph is returned.
+      */
+      glyph const* insert(glyph_bitmap const& bitmap)
+      {
+        auto cached = glyphs_.find(bitmap.code_point);
+        if( cached != glyphs_.end() )
+        {
+          return &cached->second;
+        }
+        return insert(bitmap.code_point, bitmap);
+      }
+
+      /** Uploads a set of glyphs rendered ahead of use */
+      void insert(std::vector<glyph_bitmap> const& bitmaps)
+      {
+        for( auto& bitmap : bitmaps )
+        {
+          insert(bitmap);
+        }
+      }
+
+    private:
+      glyph const* insert(Uint64 key, glyph_bitmap const& bitmap)
+      {
+        glyph g{{0, 0, 0, 0}, bitmap.x_offset, bitmap.y_offset, bitmap.advance};
+        if( bitmap.pixels )
+        {
+          int w = bitmap.pixels->w;
+          int h = bitmap.pixels->h;
+          if( !allocate(w, h, g.rect) )
+          {
+            clear();
+            if( !allocate(w, h, g.rect) )
+            {
+              throw std::runtime_error("Glyph too large for atlas");
+            }
+          }
+          SDL_UpdateTexture(texture_.get(),
+                            &g.rect,
+                            bitmap.pixels->pixels,
+                            bitmap.pixels->pitch);
+        }
+        return &glyphs_.emplace(key, g).first->second;
+      }
+
+      // Shelf packing with a one pixel gutter between glyphs
+      bool allocate(int w, int h, SDL_Rect& rect)
+      {
+        if( shelf_x_ + w + 1 > width_ )
+        {
+          shelf_x_ = 0;
+          shelf_y_ += shelf_height_;
+          shelf_height_ = 0;
+        }
+        if( shelf_y_ + h + 1 > height_ || w + 1 > width_ )
+        {
+          return false;
+        }
+
+        rect = SDL_Rect{shelf_x_, shelf_y_, w, h};
+        shelf_x_ += w + 1;
+        shelf_height_ = std::max(shelf_height_, h + 1);
+        return true;
+      }
+
+      // Fills the texture with transparent pixels, so the gutters between
+      // glyphs do not bleed into filtered or scaled glyphs
+      void clear_texture()
+      {
+        void* pixels = nullptr;
+        int pitch = 0;
+        if( SDL_LockTexture(texture_.get(), nullptr, &pixels, &pitch) != 0 )
+        {
+          sdl::throw_error("Failed to lock glyph atlas texture: ");
+        }
+        for( int y = 0; y < height_; ++y )
+        {
+          std::memset(static_cast<Uint8*>(pixels) + y * pitch, 0, width_ * sizeof(Uint32));
+        }
+        SDL_UnlockTexture(texture_.get());
+      }
+
+    private:
+      renderer const& r_;
+      font font_;
+      texture texture_;
+      int width_;
+      int height_;
+      font_metrics metrics_;
+      std::unordered_map<Uint64, glyph> glyphs_;
+      int shelf_x_ = 0;
+      int shelf_y_ = 0;
+      int shelf_height_ = 0;
+      quad_batch quads_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_GLYPH_ATLAS_H
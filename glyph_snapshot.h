@@ -0,0 +1,307 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_GLYPH_SNAPSHOT_H
+#define SDL2_CPP_GLYPH_SNAPSHOT_H
+
+#include "font_face.h"
+#include "font_loader.h"
+#include "ttf.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** Identifies the glyphs held by a snapshot: the font file contents,
+        point size, rendering settings of the font and the character set
+        rendered
+    */
+    struct glyph_snapshot_key
+    {
+      Uint64 font_hash = 0;
+      Uint32 point_size = 0;
+      Uint32 style = 0;
+      Uint32 hinting = 0;
+      Uint32 outline = 0;
+      Uint64 charset_hash = 0;
+
+      bool operator==(glyph_snapshot_key const& other) const
+      {
+        return (font_hash == other.font_hash &&
+                point_size == other.point_size &&
+                style == other.style &&
+                hinting == other.hinting &&
+                outline == other.outline &&
+                charset_hash == other.charset_hash);
+      }
+    };
+
+    /** FNV-1a hash of a block of memory, consumed eight bytes at a time */
+    inline Uint64 hash_bytes(void const* data, std::size_t size)
+    {
+      Uint64 const prime = 1099511628211ull;
+      Uint64 h = 14695981039346656037ull ^ size;
+      auto bytes = static_cast<Uint8 const*>(data);
+      std::size_t i = 0;
+      for( ; i + 8 <= size; i += 8 )
+      {
+        Uint64 word;
+        std::memcpy(&word, bytes + i, 8);
+        h = (h ^ word) * prime;
+      }
+      for( ; i < size; ++i )
+      {
+        h = (h ^ bytes[i]) * prime;
+      }
+      return h;
+    }
+
+    /** Makes the key for glyphs of charset rendered with f, which must have
+        been opened from face at point_size
+    */
+    inline glyph_snapshot_key make_snapshot_key(font_face const& face,
+                                                font const& f,
+                                                int point_size,
+                                                std::string_view charset)
+    {
+      return glyph_snapshot_key{hash_bytes(face.data(), face.size()),
+                                static_cast<Uint32>(point_size),
+                                static_cast<Uint32>(TTF_GetFontStyle(f.get())),
+                                static_cast<Uint32>(TTF_GetFontHinting(f.get())),
+                                static_cast<Uint32>(TTF_GetFontOutline(f.get())),
+                                hash_bytes(charset.data(), charset.size())};
+    }
+
+    namespace detail
+    {
+      static char const snapshot_magic[4] = {'S', 'G', 'L', 'Y'};
+      static Uint32 const snapshot_version = 2;
+      static Uint32 const snapshot_max_glyph_size = 4096;
+
+      struct rwops_closer
+      {
+        void operator()(SDL_RWops* rw) const
+        {
+          SDL_RWclose(rw);
+        }
+      };
+      using rwops = std::unique_ptr<SDL_RWops, rwops_closer>;
+
+      // SDL_ReadLE32 and SDL_ReadLE64 cannot report a short read, so values
+      // are read as fixed size records instead
+      inline bool read_le32(SDL_RWops* rw, Uint32& value)
+      {
+        if( SDL_RWread(rw, &value, sizeof(value), 1) != 1 )
+        {
+          return false;
+        }
+        value = SDL_SwapLE32(value);
+        return true;
+      }
+
+      inline bool read_le64(SDL_RWops* rw, Uint64& value)
+      {
+        if( SDL_RWread(rw, &value, sizeof(value), 1) != 1 )
+        {
+          return false;
+        }
+        value = SDL_SwapLE64(value);
+        return true;
+      }
+
+      inline bool read_le32(SDL_RWops* rw, int& value)
+      {
+        Uint32 v = 0;
+        if( !read_le32(rw, v) )
+        {
+          return false;
+        }
+        value = static_cast<Sint32>(v);
+        return true;
+      }
+    }
+
+    /** Writes glyphs to a snapshot file. Only the alpha channel of each glyph
+        is stored, as glyphs are always rendered in white.
+
+        The snapshot is written to a temporary file that is renamed over
+        path once complete, so readers never see a partly written snapshot.
+
+        Returns false if the file could not be written.
+    */
+    inline bool save_glyph_snapshot(std::string const& path,
+                                    glyph_snapshot_key const& k,
+                                    std::vector<glyph_bitmap> const& glyphs)
+    {
+      auto temp_path = path + "." + std::to_string(getpid()) + ".tmp";
+      detail::rwops rw(SDL_RWFromFile(temp_path.c_str(), "wb"));
+      if( !rw )
+      {
+        return false;
+      }
+
+      bool ok = SDL_RWwrite(rw.get(), detail::snapshot_magic, 4, 1) == 1;
+      ok = ok && SDL_WriteLE32(rw.get(), detail::snapshot_version) == 1;
+      ok = ok && SDL_WriteLE64(rw.get(), k.font_hash) == 1;
+      ok = ok && SDL_WriteLE32(rw.get(), k.point_size) == 1;
+      ok = ok && SDL_WriteLE32(rw.get(), k.style) == 1;
+      ok = ok && SDL_WriteLE32(rw.get(), k.hinting) == 1;
+      ok = ok && SDL_WriteLE32(rw.get(), k.outline) == 1;
+      ok = ok && SDL_WriteLE64(rw.get(), k.charset_hash) == 1;
+      ok = ok && SDL_WriteLE32(rw.get(), static_cast<Uint32>(glyphs.size())) == 1;
+
+      std::vector<Uint8> alpha;
+      for( auto& g : glyphs )
+      {
+        Uint32 w = g.pixels ? g.pixels->w : 0;
+        Uint32 h = g.pixels ? g.pixels->h : 0;
+        ok = ok && SDL_WriteLE32(rw.get(), g.code_point) == 1;
+        ok = ok && SDL_WriteLE32(rw.get(), static_cast<Uint32>(g.x_offset)) == 1;
+        ok = ok && SDL_WriteLE32(rw.get(), static_cast<Uint32>(g.y_offset)) == 1;
+        ok = ok && SDL_WriteLE32(rw.get(), static_cast<Uint32>(g.advance)) == 1;
+        ok = ok && SDL_WriteLE32(rw.get(), w) == 1;
+        ok = ok && SDL_WriteLE32(rw.get(), h) == 1;
+        if( ok && w != 0 )
+        {
+          alpha.resize(w * h);
+          for( Uint32 y = 0; y < h; ++y )
+          {
+            auto row = reinterpret_cast<Uint32 const*>(
+              static_cast<Uint8 const*>(g.pixels->pixels) + y * g.pixels->pitch);
+            for( Uint32 x = 0; x < w; ++x )
+            {
+              alpha[y * w + x] = static_cast<Uint8>(row[x] >> 24);
+            }
+          }
+          ok = SDL_RWwrite(rw.get(), alpha.data(), alpha.size(), 1) == 1;
+        }
+      }
+
+      ok = SDL_RWclose(rw.release()) == 0 && ok;
+      if( !ok || std::rename(temp_path.c_str(), path.c_str()) != 0 )
+      {
+        std::remove(temp_path.c_str());
+        return false;
+      }
+      return true;
+    }
+
+    /** Reads glyphs from a snapshot file without using FreeType.
+
+        Returns false, leaving glyphs unchanged, if the file is missing,
+        corrupt or was written for a different key.
+    */
+    inline bool load_glyph_snapshot(std::string const& path,
+                                    glyph_snapshot_key const& k,
+                                    std::vector<glyph_bitmap>& glyphs)
+    {
+      detail::rwops rw(SDL_RWFromFile(path.c_str(), "rb"));
+      if( !rw )
+      {
+        return false;
+      }
+
+      char magic[4];
+      Uint32 version = 0;
+      if( SDL_RWread(rw.get(), magic, 4, 1) != 1 ||
+          std::memcmp(magic, detail::snapshot_magic, 4) != 0 ||
+          !detail::read_le32(rw.get(), version) ||
+          version != detail::snapshot_version )
+      {
+        return false;
+      }
+
+      glyph_snapshot_key stored;
+      Uint32 count = 0;
+      if( !detail::read_le64(rw.get(), stored.font_hash) ||
+          !detail::read_le32(rw.get(), stored.point_size) ||
+          !detail::read_le32(rw.get(), stored.style) ||
+          !detail::read_le32(rw.get(), stored.hinting) ||
+          !detail::read_le32(rw.get(), stored.outline) ||
+          !detail::read_le64(rw.get(), stored.charset_hash) ||
+          !(stored == k) ||
+          !detail::read_le32(rw.get(), count) ||
+          count > 0x110000 )
+      {
+        return false;
+      }
+      std::vector<glyph_bitmap> loaded;
+      loaded.reserve(count);
+      std::vector<Uint8> alpha;
+      for( Uint32 i = 0; i < count; ++i )
+      {
+        glyph_bitmap g;
+        Uint32 w = 0;
+        Uint32 h = 0;
+        if( !detail::read_le32(rw.get(), g.code_point) ||
+            !detail::read_le32(rw.get(), g.x_offset) ||
+            !detail::read_le32(rw.get(), g.y_offset) ||
+            !detail::read_le32(rw.get(), g.advance) ||
+            !detail::read_le32(rw.get(), w) ||
+            !detail::read_le32(rw.get(), h) ||
+            w > detail::snapshot_max_glyph_size ||
+            h > detail::snapshot_max_glyph_size )
+        {
+          return false;
+        }
+        if( w != 0 && h != 0 )
+        {
+          alpha.resize(w * h);
+          if( SDL_RWread(rw.get(), alpha.data(), alpha.size(), 1) != 1 )
+          {
+            return false;
+          }
+          g.pixels.reset(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888));
+          if( !g.pixels )
+          {
+            return false;
+          }
+          for( Uint32 y = 0; y < h; ++y )
+          {
+            auto row = reinterpret_cast<Uint32*>(
+              static_cast<Uint8*>(g.pixels->pixels) + y * g.pixels->pitch);
+            for( Uint32 x = 0; x < w; ++x )
+            {
+              row[x] = (Uint32(alpha[y * w + x]) << 24) | 0x00FFFFFF;
+            }
+          }
+        }
+        loaded.push_back(std::move(g));
+      }
+      glyphs = std::move(loaded);
+      return true;
+    }
+
+    /** Loads the glyphs of charset from a snapshot file, or renders them
+        with f and writes a new snapshot if the file does not match.
+
+        f must have been opened from face at point_size.
+    */
+    inline std::vector<glyph_bitmap> load_or_render_glyphs(std::string const& path,
+                                                           font_face const& face,
+                                                           font const& f,
+                                                           int point_size,
+                                                           std::string_view charset)
+    {
+      auto k = make_snapshot_key(face, f, point_size, charset);
+      std::vector<glyph_bitmap> glyphs;
+      if( !load_glyph_snapshot(path, k, glyphs) )
+      {
+        glyphs = render_glyphs(f, charset);
+        save_glyph_snapshot(path, k, glyphs);
+      }
+      return glyphs;
+    }
+  }
+}
+
+#endif // SDL2_CPP_GLYPH_SNAPSHOT_H
@@ -0,0 +1,189 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_INPLACE_FUNCTION_H
+#define SDL2_CPP_INPLACE_FUNCTION_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sdl2
+{
+  template<class Signature, std::size_t Capacity = 48>
+  class inplace_function;
+
+  /** A move only callable wrapper like std::function that stores the
+      callable in a fixed size buffer within itself.
+
+      Callables of up to Capacity bytes that are nothrow move constructible
+      are stored without allocating. Larger callables are allocated on the
+      heap, as std::function would. Calling is a single indirect call.
+  */
+  template<class R, class... Args, std::size_t Capacity>
+  class inplace_function<R(Args...), Capacity>
+  {
+  public:
+    inplace_function() = default;
+
+    template<class Function,
+             class = std::enable_if_t<
+               !std::is_same_v<std::decay_t<Function>, inplace_function>>>
+    inplace_function(Function&& f)
+    {
+      using callable = std::decay_t<Function>;
+      if constexpr( stored_inline<callable>() )
+      {
+        new(storage_) callable(std::forward<Function>(f));
+        invoke_ = [](void* c, Args... args) -> R
+        {
+          return std::invoke(*static_cast<callable*>(c), std::forward<Args>(args)...);
+        };
+        manage_ = [](void* dst, void* src)
+        {
+          auto c = static_cast<callable*>(src);
+          if( dst != nullptr )
+          {
+            new(dst) callable(std::move(*c));
+          }
+          c->~callable();
+        };
+      }
+      else
+      {
+        new(storage_) callable*(new callable(std::forward<Function>(f)));
+        invoke_ = [](void* c, Args... args) -> R
+        {
+          return std::invoke(**static_cast<callable**>(c), std::forward<Args>(args)...);
+        };
+        manage_ = [](void* dst, void* src)
+        {
+          auto c = static_cast<callable**>(src);
+          if( dst != nullptr )
+          {
+            new(dst) callable*(*c);
+          }
+          else
+          {
+            delete *c;
+          }
+        };
+      }
+    }
+
+    /** Returns true if callables of type Function are stored without
+        allocating
+    */
+    template<class Function>
+    static constexpr bool stored_inline()
+    {
+      return (sizeof(Function) <= Capacity &&
+              alignof(Function) <= alignof(std::max_align_t) &&
+              std::is_nothrow_move_constructible_v<Function>);
+    }
+
+    inplace_function(inplace_function&& other) noexcept
+    {
+      take(other);
+    }
+
+    inplace_function& operator=(inplace_function&& other) noexcept
+    {
+      if( this != &other )
+      {
+        reset();
+        take(other);
+      }
+      return *this;
+    }
+
+    inplace_function(inplace_function const&) = delete;
+    void operator=(inplace_function const&) = delete;
+
+    ~inplace_function()
+    {
+      reset();
+    }
+
+    R operator()(Args... args)
+    {
+      return invoke_(storage_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const
+    {
+      return invoke_ != nullptr;
+    }
+
+  private:
+    void reset()
+    {
+      if( manage_ != nullptr )
+      {
+        manage_(nullptr, storage_);
+      }
+      invoke_ = nullptr;
+      manage_ = nullptr;
+    }
+
+    // Moves the callable out of other, leaving it empty
+    void take(inplace_function& other)
+    {
+      if( other.manage_ != nullptr )
+      {
+        other.manage_(storage_, other.storage_);
+      }
+      invoke_ = other.invoke_;
+      manage_ = other.manage_;
+      other.invoke_ = nullptr;
+      other.manage_ = nullptr;
+    }
+
+  private:
+    alignas(std::max_align_t) unsigned char storage_[Capacity];
+    R (*invoke_)(void*, Args...) = nullptr;
+    void (*manage_)(void* dst, void* src) = nullptr;
+  };
+
+  template<class Signature>
+  class function_ref;
+
+  /** A non-owning reference to a callable.
+
+      The callable must outlive the function_ref and every copy of it. It is
+      two pointers in size, so it is always stored in an inplace_function
+      without allocating.
+  */
+  template<class R, class... Args>
+  class function_ref<R(Args...)>
+  {
+  public:
+    template<class Function,
+             class = std::enable_if_t<
+               !std::is_same_v<std::decay_t<Function>, function_ref>>>
+    function_ref(Function&& f)
+      : callable_(const_cast<void*>(static_cast<void const*>(std::addressof(f))))
+      , invoke_([](void* c, Args... args) -> R
+                {
+                  return std::invoke(*static_cast<std::remove_reference_t<Function>*>(c),
+                                     std::forward<Args>(args)...);
+                })
+    {
+    }
+
+    R operator()(Args... args) const
+    {
+      return invoke_(callable_, std::forward<Args>(args)...);
+    }
+
+  private:
+    void* callable_;
+    R (*invoke_)(void*, Args...);
+  };
+} // namespace sdl2
+
+#endif // SDL2_CPP_INPLACE_FUNCTION_H
@@ -0,0 +1,225 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_NUMBER_RENDERER_H
+#define SDL2_CPP_NUMBER_RENDERER_H
+
+#include "ttf.h"
+
+#include <array>
+#include <charconv>
+#include <string_view>
+#include <type_traits>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** Draws frequently changing numbers from a pre-rendered strip of
+        digits.
+
+        The digits, signs, separators and decimal point are rendered once
+        into a small static texture. Numbers are formatted without
+        allocating and queued as quads, which render() draws with a single
+        SDL_RenderGeometry call. Digits share the width of the widest digit
+        so changing values do not jitter.
+
+        The renderer must outlive the number_renderer.
+    */
+    class number_renderer
+    {
+    public:
+      enum class align
+      {
+        left,
+        right
+      };
+
+      number_renderer(renderer const& r, font const& f)
+        : r_(r)
+        , texture_(nullptr, SDL_DestroyTexture)
+      {
+        std::array<glyph_bitmap, characters.size()> bitmaps;
+        int strip_width = 0;
+        int strip_height = 1;
+        for( std::size_t i = 0; i < characters.size(); ++i )
+        {
+          bitmaps[i] = render_glyph(f, static_cast<unsigned char>(characters[i]));
+          if( bitmaps[i].pixels )
+          {
+            strip_width += bitmaps[i].pixels->w + 1;
+            strip_height = std::max(strip_height, bitmaps[i].pixels->h);
+          }
+        }
+
+        surface strip(SDL_CreateRGBSurfaceWithFormat(0,
+                                                     std::max(1, strip_width),
+                                                     strip_height,
+                                                     32,
+                                                     SDL_PIXELFORMAT_ARGB8888),
+                      SDL_FreeSurface);
+        if( !strip )
+        {
+          sdl::throw_error("Failed to create digit strip: ");
+        }
+        SDL_FillRect(strip.get(), nullptr, 0);
+
+        int x = 0;
+        for( std::size_t i = 0; i < characters.size(); ++i )
+        {
+          auto& b = bitmaps[i];
+          auto& g = glyphs_[i];
+          g.advance = b.advance;
+          g.x_offset = b.x_offset;
+          g.y_offset = b.y_offset;
+          if( b.pixels )
+          {
+            g.rect = SDL_Rect{x, 0, b.pixels->w, b.pixels->h};
+            SDL_SetSurfaceBlendMode(b.pixels.get(), SDL_BLENDMODE_NONE);
+            auto at = g.rect;
+            SDL_BlitSurface(b.pixels.get(), nullptr, strip.get(), &at);
+            x += b.pixels->w + 1;
+          }
+        }
+
+        // Centre each digit within the widest digit's advance
+        int digit_width = 0;
+        for( std::size_t i = 0; i < 10; ++i )
+        {
+          digit_width = std::max(digit_width, glyphs_[i].advance);
+        }
+        for( std::size_t i = 0; i < 10; ++i )
+        {
+          glyphs_[i].x_offset += (digit_width - glyphs_[i].advance) / 2;
+          glyphs_[i].advance = digit_width;
+        }
+
+        texture_ = create_texture_from_surface(r, strip);
+        if( !texture_ )
+        {
+          sdl::throw_error("Failed to create digit strip texture: ");
+        }
+        SDL_SetTextureBlendMode(texture_.get(), SDL_BLENDMODE_BLEND);
+        texture_width_ = strip->w;
+        texture_height_ = strip->h;
+      }
+
+      number_renderer(number_renderer const&) = delete;
+      void operator=(number_renderer const&) = delete;
+
+      /** Returns the width in pixels of a formatted number. Characters not in
+          the strip are ignored.
+      */
+      int measure(std::string_view text) const
+      {
+        int w = 0;
+        for( char ch : text )
+        {
+          if( auto g = find(ch) )
+          {
+            w += g->advance;
+          }
+        }
+        return w;
+      }
+
+      /** Queues an already formatted number with the top of the line at y.
+          Characters not in the strip are skipped.
+
+          Returns the pen position following the last character.
+      */
+      float add(std::string_view text, float x, float y, SDL_Color const& c, align a = align::left)
+      {
+        if( a == align::right )
+        {
+          x -= measure(text);
+        }
+        for( char ch : text )
+        {
+          if( auto g = find(ch) )
+          {
+            add(*g, x, y, c);
+            x += g->advance;
+          }
+        }
+        return x;
+      }
+
+      /** Queues an integer. Only integral types are accepted, so a floating
+          point value must be given a precision rather than being truncated.
+      */
+      template<class Integer,
+               class = std::enable_if_t<std::is_integral_v<Integer> &&
+                                        !std::is_same_v<Integer, bool>>>
+      float add(Integer value, float x, float y, SDL_Color const& c, align a = align::left)
+      {
+        char buffer[48];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        if( result.ec != std::errc() )
+        {
+          return x;
+        }
+        return add(std::string_view(buffer, result.ptr - buffer), x, y, c, a);
+      }
+
+      /** Queues a floating point value with a fixed number of decimal places */
+      float add(double value, int precision, float x, float y, SDL_Color const& c, align a = align::left)
+      {
+        char buffer[64];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value,
+                                    std::chars_format::fixed, precision);
+        if( result.ec != std::errc() )
+        {
+          return x;
+        }
+        return add(std::string_view(buffer, result.ptr - buffer), x, y, c, a);
+      }
+
+      /** Draws all queued numbers and empties the queue */
+      void render()
+      {
+        quads_.render(r_, texture_);
+      }
+
+    private:
+      struct glyph
+      {
+        SDL_Rect rect = {0, 0, 0, 0};
+        int x_offset = 0;
+        int y_offset = 0;
+        int advance = 0;
+      };
+
+      // Digits must come first, as they are made the same width
+      static constexpr std::string_view characters = "0123456789+-.,:% ";
+
+      glyph const* find(char ch) const
+      {
+        auto i = characters.find(ch);
+        return i == std::string_view::npos ? nullptr : &glyphs_[i];
+      }
+
+      void add(glyph const& g, float x, float y, SDL_Color const& c)
+      {
+        if( g.rect.w == 0 )
+        {
+          return;
+        }
+
+        quads_.add(g.rect, texture_width_, texture_height_, x + g.x_offset, y + g.y_offset, c);
+      }
+
+    private:
+      renderer const& r_;
+      texture texture_;
+      int texture_width_ = 1;
+      int texture_height_ = 1;
+      std::array<glyph, characters.size()> glyphs_;
+      quad_batch quads_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_NUMBER_RENDERER_H
@@ -0,0 +1,260 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_PARAGRAPH_H
+#define SDL2_CPP_PARAGRAPH_H
+
+#include "font_metrics.h"
+#include "glyph_atlas.h"
+#include "ttf.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** A paragraph of UTF-8 text wrapped to a width.
+
+        Break opportunities and the pen position at each of them are found
+        once, when the paragraph is created, so wrapping to a width is a
+        linear pass over the breaks rather than repeated measurement of
+        growing prefixes. Layouts are cached per width, and a new width
+        reuses the leading lines of the previous layout that it leaves
+        unchanged.
+
+        Lines break after spaces and hyphens and always at newlines. A word
+        wider than the paragraph overflows on a line of its own.
+
+        The metrics must outlive the paragraph.
+    */
+    class paragraph
+    {
+    public:
+      /** A wrapped line: a byte range of the text, excluding trailing spaces
+          and newline, and its width in pixels
+      */
+      struct line
+      {
+        std::size_t begin;
+        std::size_t end;
+        int width;
+        std::size_t first_segment;
+        std::size_t last_segment;
+      };
+
+      paragraph(font_metrics& m, std::string text)
+        : metrics_(m)
+        , text_(std::move(text))
+      {
+        segment_text();
+      }
+
+      std::string const& text() const
+      {
+        return text_;
+      }
+
+      /** Returns the text of a line */
+      std::string_view line_text(line const& l) const
+      {
+        return std::string_view(text_).substr(l.begin, l.end - l.begin);
+      }
+
+      /** Returns the lines of the paragraph wrapped to the specified width */
+      std::vector<line> const& layout(int width)
+      {
+        auto cached = layouts_.find(width);
+        if( cached != layouts_.end() )
+        {
+          last_width_ = width;
+          return cached->second;
+        }
+
+        if( layouts_.size() >= max_cached_layouts )
+        {
+          auto keep = layouts_.find(last_width_);
+          std::vector<line> previous;
+          if( keep != layouts_.end() )
+          {
+            previous = std::move(keep->second);
+          }
+          layouts_.clear();
+          if( !previous.empty() )
+          {
+            layouts_.emplace(last_width_, std::move(previous));
+          }
+        }
+
+        std::vector<line> lines;
+        std::size_t next = 0;
+        auto previous = layouts_.find(last_width_);
+        if( previous != layouts_.end() )
+        {
+          for( auto& l : previous->second )
+          {
+            if( !still_fits(l, width) )
+            {
+              break;
+            }
+            lines.push_back(l);
+            next = l.last_segment + 1;
+          }
+        }
+        wrap(next, width, lines);
+
+        last_width_ = width;
+        return layouts_.emplace(width, std::move(lines)).first->second;
+      }
+
+      /** Returns the height in pixels of the paragraph wrapped to the
+          specified width
+      */
+      int height(int width)
+      {
+        auto n = static_cast<int>(layout(width).size());
+        return n == 0 ? 0 : (n - 1) * metrics_.line_skip() + metrics_.height();
+      }
+
+      /** Queues the paragraph wrapped to the specified width on a glyph atlas
+          with its top left at (x, y). The atlas should use the same font as
+          the metrics.
+      */
+      void add(glyph_atlas& atlas, int width, float x, float y, SDL_Color const& c)
+      {
+        for( auto& l : layout(width) )
+        {
+          atlas.add(line_text(l), x, y, c);
+          y += metrics_.line_skip();
+        }
+      }
+
+    private:
+      static constexpr std::size_t max_cached_layouts = 8;
+
+      // Text between two break opportunities. The pen positions are
+      // measured from the start of the text's hard line.
+      struct segment
+      {
+        std::size_t begin;
+        std::size_t ink_end;
+        std::size_t end;
+        int x_begin;
+        int x_ink_end;
+        bool hard_break;
+      };
+
+      void segment_text()
+      {
+        int x = 0;
+        Uint32 previous = 0;
+        segment current{0, 0, 0, 0, 0, false};
+        bool in_spaces = false;
+        std::size_t pos = 0;
+        while( pos < text_.size() )
+        {
+          auto start = pos;
+          auto cp = next_code_point(text_, pos);
+          if( cp == '\n' )
+          {
+            current.end = pos;
+            current.hard_break = true;
+            segments_.push_back(current);
+            x = 0;
+            previous = 0;
+            current = segment{pos, pos, pos, 0, 0, false};
+            in_spaces = false;
+            continue;
+          }
+
+          if( in_spaces && cp != ' ' )
+          {
+            current.end = start;
+            segments_.push_back(current);
+            current = segment{start, start, start, x, x, false};
+            in_spaces = false;
+          }
+
+          if( previous != 0 )
+          {
+            x += metrics_.kerning(previous, cp);
+          }
+          x += metrics_.advance(cp);
+          previous = cp;
+
+          if( cp == ' ' )
+          {
+            in_spaces = true;
+          }
+          else
+          {
+            current.ink_end = pos;
+            current.x_ink_end = x;
+            if( cp == '-' )
+            {
+              current.end = pos;
+              segments_.push_back(current);
+              current = segment{pos, pos, pos, x, x, false};
+            }
+          }
+        }
+        current.end = text_.size();
+        if( current.begin < current.end || segments_.empty() || segments_.back().hard_break )
+        {
+          segments_.push_back(current);
+        }
+      }
+
+      int span_width(std::size_t first, std::size_t last) const
+      {
+        return segments_[last].x_ink_end - segments_[first].x_begin;
+      }
+
+      bool still_fits(line const& l, int width) const
+      {
+        if( l.first_segment != l.last_segment && l.width > width )
+        {
+          return false;
+        }
+        auto next = l.last_segment + 1;
+        return (segments_[l.last_segment].hard_break ||
+                next == segments_.size() ||
+                span_width(l.first_segment, next) > width);
+      }
+
+      void wrap(std::size_t first, int width, std::vector<line>& lines) const
+      {
+        while( first < segments_.size() )
+        {
+          auto last = first;
+          while( !segments_[last].hard_break &&
+                 last + 1 < segments_.size() &&
+                 span_width(first, last + 1) <= width )
+          {
+            ++last;
+          }
+          lines.push_back(line{segments_[first].begin,
+                               segments_[last].ink_end,
+                               span_width(first, last),
+                               first,
+                               last});
+          first = last + 1;
+        }
+      }
+
+    private:
+      font_metrics& metrics_;
+      std::string text_;
+      std::vector<segment> segments_;
+      std::unordered_map<int, std::vector<line>> layouts_;
+      int last_width_ = -1;
+    };
+  }
+}
+
+#endif // SDL2_CPP_PARAGRAPH_H
@@ -0,0 +1,344 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_SDF_FONT_H
+#define SDL2_CPP_SDF_FONT_H
+
+#include "font_metrics.h"
+#include "ttf.h"
+
+#include <cmath>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** Renders text at any scale from signed distance fields.
+
+        Each glyph is rendered once from a reference font, typically opened
+        at a large point size, and converted to a signed distance field.
+        Text is then drawn at any scale by sampling the distance fields, so
+        zooming needs neither new font objects nor re-rasterization by
+        FreeType.
+
+        SDL's renderer has no programmable shaders, so the distance fields
+        are thresholded on the CPU into surfaces in ARGB8888 format.
+    */
+    class sdf_font
+    {
+    public:
+      /** Creates distance fields from the reference font, encoding distances
+          of up to spread pixels either side of each glyph's outline
+      */
+      explicit sdf_font(font reference, int spread = 8)
+        : font_(std::move(reference))
+        , metrics_(font_)
+        , spread_(spread)
+      {
+      }
+
+      sdf_font(sdf_font const&) = delete;
+      void operator=(sdf_font const&) = delete;
+
+      font const& get_font() const
+      {
+        return font_;
+      }
+
+      /** Returns the height in pixels of a line at the specified scale */
+      int height(float scale) const
+      {
+        return static_cast<int>(std::ceil(metrics_.height() * scale));
+      }
+
+      /** Returns the width in pixels of the specified UTF-8 string at the
+          specified scale
+      */
+      int measure(std::string_view text, float scale)
+      {
+        return static_cast<int>(std::ceil(metrics_.measure(text) * scale));
+      }
+
+      /** Renders the specified string at the specified scale. The pen starts
+          far enough right that glyphs extending left of it are not clipped.
+
+          The surface is owned by the returned unique_ptr.
+      */
+      surface render_blended(std::string_view text, float scale, SDL_Color const& c)
+      {
+        surface s(SDL_CreateRGBSurfaceWithFormat(0,
+                                                 std::max(1, measure(text, scale)),
+                                                 std::max(1, height(scale)),
+                                                 32,
+                                                 SDL_PIXELFORMAT_ARGB8888),
+                  SDL_FreeSurface);
+        if( !s )
+        {
+          sdl::throw_error("Failed to create text surface: ");
+        }
+        SDL_FillRect(s.get(), nullptr, 0);
+        render_blended(text, scale, c, s, metrics_.left_overhang(text) * scale, 0.0f);
+        return s;
+      }
+
+      /** Blends the specified string at the specified scale into dst, with
+          the top left of the line at (x, y). dst must be in ARGB8888 format
+          and is clipped to its clip rectangle.
+
+          Returns the pen position following the last glyph.
+      */
+      float render_blended(std::string_view text,
+                           float scale,
+                           SDL_Color const& c,
+                           surface const& dst,
+                           float x,
+                           float y)
+      {
+        if( dst->format->format != SDL_PIXELFORMAT_ARGB8888 )
+        {
+          throw std::runtime_error("SDF text requires an ARGB8888 surface");
+        }
+
+        if( SDL_MUSTLOCK(dst.get()) )
+        {
+          SDL_LockSurface(dst.get());
+        }
+        Uint32 previous = 0;
+        std::size_t pos = 0;
+        while( pos < text.size() )
+        {
+          auto cp = next_code_point(text, pos);
+          if( previous != 0 )
+          {
+            x += metrics_.kerning(previous, cp) * scale;
+          }
+          auto& g = find(cp);
+          draw(g, scale, c, dst.get(), x, y);
+          x += g.advance * scale;
+          previous = cp;
+        }
+        if( SDL_MUSTLOCK(dst.get()) )
+        {
+          SDL_UnlockSurface(dst.get());
+        }
+        return x;
+      }
+
+    private:
+      // A distance field padded by spread_ on each side. Values above 128
+      // are inside the glyph.
+      struct glyph
+      {
+        int w = 0;
+        int h = 0;
+        int x_offset = 0;
+        int y_offset = 0;
+        int advance = 0;
+        std::vector<Uint8> distance;
+      };
+
+      glyph const& find(Uint32 code_point)
+      {
+        auto cached = glyphs_.find(code_point);
+        if( cached == glyphs_.end() )
+        {
+          cached = glyphs_.emplace(code_point, generate(render_glyph(font_, code_point))).first;
+        }
+        return cached->second;
+      }
+
+      glyph generate(glyph_bitmap const& bitmap) const
+      {
+        glyph g;
+        g.advance = bitmap.advance;
+        if( !bitmap.pixels )
+        {
+          return g;
+        }
+
+        g.w = bitmap.pixels->w + 2 * spread_;
+        g.h = bitmap.pixels->h + 2 * spread_;
+        g.x_offset = bitmap.x_offset - spread_;
+        g.y_offset = bitmap.y_offset - spread_;
+
+        std::vector<bool> inside(g.w * g.h, false);
+        for( int y = 0; y < bitmap.pixels->h; ++y )
+        {
+          auto row = reinterpret_cast<Uint32 const*>(
+            static_cast<Uint8 const*>(bitmap.pixels->pixels) + y * bitmap.pixels->pitch);
+          for( int x = 0; x < bitmap.pixels->w; ++x )
+          {
+            inside[(y + spread_) * g.w + x + spread_] = (row[x] >> 24) >= 0x80;
+          }
+        }
+
+        auto to_outside = distance_transform(inside, g.w, g.h, true);
+        auto to_inside = distance_transform(inside, g.w, g.h, false);
+        g.distance.resize(g.w * g.h);
+        for( int i = 0; i < g.w * g.h; ++i )
+        {
+          // Positive inside the glyph
+          float d = std::sqrt(to_outside[i]) - std::sqrt(to_inside[i]);
+          float v = 128.0f + d * 127.0f / spread_;
+          g.distance[i] = static_cast<Uint8>(std::min(255.0f, std::max(0.0f, v)));
+        }
+        return g;
+      }
+
+      // Squared Euclidean distance from each pixel to the nearest pixel whose
+      // inside flag differs from the one given (Felzenszwalb & Huttenlocher)
+      static std::vector<float> distance_transform(std::vector<bool> const& inside,
+                                                   int w,
+                                                   int h,
+                                                   bool from_inside)
+      {
+        float const far = 1e20f;
+        std::vector<float> grid(w * h);
+        for( int i = 0; i < w * h; ++i )
+        {
+          grid[i] = inside[i] == from_inside ? far : 0.0f;
+        }
+
+        int n = std::max(w, h);
+        std::vector<float> f(n);
+        std::vector<float> d(n);
+        std::vector<float> z(n + 1);
+        std::vector<int> v(n);
+        for( int x = 0; x < w; ++x )
+        {
+          for( int y = 0; y < h; ++y )
+          {
+            f[y] = grid[y * w + x];
+          }
+          transform_1d(f.data(), h, d.data(), v.data(), z.data());
+          for( int y = 0; y < h; ++y )
+          {
+            grid[y * w + x] = d[y];
+          }
+        }
+        for( int y = 0; y < h; ++y )
+        {
+          std::copy(grid.begin() + y * w, grid.begin() + (y + 1) * w, f.begin());
+          transform_1d(f.data(), w, d.data(), v.data(), z.data());
+          std::copy(d.begin(), d.begin() + w, grid.begin() + y * w);
+        }
+        return grid;
+      }
+
+      static void transform_1d(float const* f, int n, float* d, int* v, float* z)
+      {
+        float const far = 1e20f;
+        int k = 0;
+        v[0] = 0;
+        z[0] = -far;
+        z[1] = far;
+        for( int q = 1; q < n; ++q )
+        {
+          float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+          while( s <= z[k] )
+          {
+            --k;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+          }
+          ++k;
+          v[k] = q;
+          z[k] = s;
+          z[k + 1] = far;
+        }
+        k = 0;
+        for( int q = 0; q < n; ++q )
+        {
+          while( z[k + 1] < q )
+          {
+            ++k;
+          }
+          d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+        }
+      }
+
+      float sample(glyph const& g, float x, float y) const
+      {
+        x = std::min(std::max(x, 0.0f), g.w - 1.0f);
+        y = std::min(std::max(y, 0.0f), g.h - 1.0f);
+        int x0 = static_cast<int>(x);
+        int y0 = static_cast<int>(y);
+        int x1 = std::min(x0 + 1, g.w - 1);
+        int y1 = std::min(y0 + 1, g.h - 1);
+        float fx = x - x0;
+        float fy = y - y0;
+        auto at = [&g](int px, int py) { return static_cast<float>(g.distance[py * g.w + px]); };
+        float top = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * fx;
+        float bottom = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * fx;
+        return top + (bottom - top) * fy;
+      }
+
+      void draw(glyph const& g, float scale, SDL_Color const& c, SDL_Surface* dst, float x, float y) const
+      {
+        if( g.w == 0 )
+        {
+          return;
+        }
+
+        float left = x + g.x_offset * scale;
+        float top = y + g.y_offset * scale;
+        auto const& clip = dst->clip_rect;
+        int x_begin = std::max(clip.x, static_cast<int>(std::floor(left)));
+        int y_begin = std::max(clip.y, static_cast<int>(std::floor(top)));
+        int x_end = std::min(clip.x + clip.w, static_cast<int>(std::ceil(left + g.w * scale)));
+        int y_end = std::min(clip.y + clip.h, static_cast<int>(std::ceil(top + g.h * scale)));
+
+        // Distance in destination pixels covered by one step of the encoding
+        float step = spread_ / 127.0f * scale;
+        for( int py = y_begin; py < y_end; ++py )
+        {
+          auto row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(dst->pixels) + py * dst->pitch);
+          float gy = (py + 0.5f - top) / scale - 0.5f;
+          for( int px = x_begin; px < x_end; ++px )
+          {
+            float gx = (px + 0.5f - left) / scale - 0.5f;
+            float coverage = (sample(g, gx, gy) - 128.0f) * step + 0.5f;
+            if( coverage <= 0.0f )
+            {
+              continue;
+            }
+            float alpha = std::min(coverage, 1.0f) * c.a / 255.0f;
+            row[px] = blend(row[px], c, alpha);
+          }
+        }
+      }
+
+      // Source over blend of a colour into an ARGB8888 pixel
+      static Uint32 blend(Uint32 pixel, SDL_Color const& c, float alpha)
+      {
+        float dst_a = (pixel >> 24) / 255.0f;
+        float out_a = alpha + dst_a * (1.0f - alpha);
+        if( out_a <= 0.0f )
+        {
+          return 0;
+        }
+        auto channel = [&](Uint8 src, int shift)
+        {
+          float dst_c = ((pixel >> shift) & 0xFF) * dst_a;
+          return static_cast<Uint32>((src * alpha + dst_c * (1.0f - alpha)) / out_a + 0.5f);
+        };
+        return ((static_cast<Uint32>(out_a * 255.0f + 0.5f) << 24) |
+                (channel(c.r, 16) << 16) |
+                (channel(c.g, 8) << 8) |
+                channel(c.b, 0));
+      }
+
+    private:
+      font font_;
+      font_metrics metrics_;
+      int spread_;
+      std::unordered_map<Uint32, glyph> glyphs_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_SDF_FONT_H
@@ -10,6 +10,7 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <stdexcept>
+#include <vector>
 
 namespace sdl
 {
@@ -102,6 +103,9 @@ namespace sdl
   /** std::unique_ptr wrapper for SDL_Texture */
   using texture = std::unique_ptr<SDL_Texture, decltype(&SDL_DestroyTexture)>;
 
+  /** std::shared_ptr wrapper for SDL_Texture, for textures held by caches */
+  using shared_texture = std::shared_ptr<SDL_Texture>;
+
   /** Creates an SDL texture for the specified renderer, owned by the returned
       unique_ptr */
   inline texture create_texture_from_surface(renderer const& r, surface const& s)
@@ -117,6 +121,62 @@ namespace sdl
     SDL_RenderCopy(r.get(), t.get(), args...);
   }
 
+  /** Collects textured quads from a single texture and draws them with one
+      SDL_RenderGeometry call
+  */
+  class quad_batch
+  {
+  public:
+    /** Queues the src rectangle of a texture of the specified size, drawn
+        with its top left at (x, y) and modulated by c
+    */
+    void add(SDL_Rect const& src, int texture_w, int texture_h,
+             float x, float y, SDL_Color const& c)
+    {
+      float right = x + src.w;
+      float bottom = y + src.h;
+      float u0 = static_cast<float>(src.x) / texture_w;
+      float v0 = static_cast<float>(src.y) / texture_h;
+      float u1 = static_cast<float>(src.x + src.w) / texture_w;
+      float v1 = static_cast<float>(src.y + src.h) / texture_h;
+
+      int base = static_cast<int>(vertices_.size());
+      vertices_.push_back({{x, y}, c, {u0, v0}});
+      vertices_.push_back({{right, y}, c, {u1, v0}});
+      vertices_.push_back({{right, bottom}, c, {u1, v1}});
+      vertices_.push_back({{x, bottom}, c, {u0, v1}});
+      for( int i : {0, 1, 2, 0, 2, 3} )
+      {
+        indices_.push_back(base + i);
+      }
+    }
+
+    bool empty() const
+    {
+      return indices_.empty();
+    }
+
+    /** Draws all queued quads and empties the batch */
+    void render(renderer const& r, texture const& t)
+    {
+      if( !indices_.empty() )
+      {
+        SDL_RenderGeometry(r.get(),
+                           t.get(),
+                           vertices_.data(),
+                           static_cast<int>(vertices_.size()),
+                           indices_.data(),
+                           static_cast<int>(indices_.size()));
+      }
+      vertices_.clear();
+      indices_.clear();
+    }
+
+  private:
+    std::vector<SDL_Vertex> vertices_;
+    std::vector<int> indices_;
+  };
+
   /** Sets a style on a renderer and removes it on destruction */
   class style
   {
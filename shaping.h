@@ -0,0 +1,350 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_SHAPING_H
+#define SDL2_CPP_SHAPING_H
+
+#include "font_face.h"
+#include "glyph_atlas.h"
+#include "ttf.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <hb.h>
+#include <hb-ft.h>
+
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** A glyph of shaped text. Positions are in pixels. */
+    struct shaped_glyph
+    {
+      Uint32 index;
+      Uint32 cluster;
+      float x_advance;
+      float x_offset;
+      float y_offset;
+    };
+
+    /** A run of shaped glyphs in visual order */
+    struct shaped_run
+    {
+      std::vector<shaped_glyph> glyphs;
+      float advance = 0.0f;
+    };
+
+    /** Shapes text for complex scripts with HarfBuzz and caches the results.
+
+        Shaped runs are keyed by text, direction and script and evicted in
+        least recently used order, so strings that rarely change are shaped
+        once. Runs are drawn through a glyph_atlas for the same font, with
+        glyphs cached by glyph index rather than code point.
+
+        The shaper reads the font from a font_face at the same point size,
+        face index and hinting as the atlas's font, through its own FreeType
+        library, so it does not share FreeType state with SDL_ttf. Glyphs are
+        loaded with the same FreeType flags SDL_ttf uses for that hinting.
+        SDL_ttf's synthetic styles are not reproduced, so the atlas's font
+        must have TTF_STYLE_NORMAL. add() throws std::invalid_argument if the
+        atlas's font does not match the shaper's face, size, style or
+        hinting.
+
+        Requires HarfBuzz and FreeType in addition to SDL2_ttf.
+    */
+    class text_shaper
+    {
+    public:
+      text_shaper(font_face face,
+                  int point_size,
+                  long index = 0,
+                  int hinting = TTF_HINTING_NORMAL,
+                  std::size_t max_runs = 1024)
+        : face_(std::move(face))
+        , library_(nullptr, FT_Done_FreeType)
+        , ft_face_(nullptr, FT_Done_Face)
+        , hb_font_(nullptr, hb_font_destroy)
+        , buffer_(hb_buffer_create(), hb_buffer_destroy)
+        , hinting_(hinting)
+        , load_flags_(load_flags(hinting))
+        , max_runs_(max_runs)
+      {
+        FT_Library library = nullptr;
+        if( FT_Init_FreeType(&library) != 0 )
+        {
+          throw std::runtime_error("Failed to initialise FreeType");
+        }
+        library_.reset(library);
+
+        FT_Face ft_face = nullptr;
+        if( FT_New_Memory_Face(library,
+                               face_.data(),
+                               static_cast<FT_Long>(face_.size()),
+                               static_cast<FT_Long>(index),
+                               &ft_face) != 0 )
+        {
+          throw std::runtime_error("Failed to load font for shaping: " + face_.path());
+        }
+        ft_face_.reset(ft_face);
+        if( FT_Set_Char_Size(ft_face, 0, point_size * 64, 0, 0) != 0 )
+        {
+          throw std::runtime_error("Failed to set font size for shaping: " + face_.path());
+        }
+        auto& metrics = ft_face->size->metrics;
+        ascent_ = static_cast<int>((metrics.ascender + 63) >> 6);
+        // TTF_FontHeight, as SDL_ttf computes it
+        if( FT_IS_SCALABLE(ft_face) )
+        {
+          height_ = static_cast<int>(
+            (FT_MulFix(ft_face->ascender - ft_face->descender, metrics.y_scale) + 63) >> 6);
+        }
+        else
+        {
+          height_ = static_cast<int>((metrics.height + 63) >> 6);
+        }
+
+        hb_font_.reset(hb_ft_font_create_referenced(ft_face));
+        hb_ft_font_set_load_flags(hb_font_.get(), static_cast<int>(load_flags_));
+      }
+
+      text_shaper(text_shaper const&) = delete;
+      void operator=(text_shaper const&) = delete;
+
+      /** Returns the shaped glyphs for a UTF-8 string, shaping it only if it
+          is not already cached
+      */
+      std::shared_ptr<shaped_run const> shape(std::string_view text,
+                                              hb_direction_t direction,
+                                              hb_script_t script)
+      {
+        key k{std::string(text), direction, script};
+        auto cached = index_.find(k);
+        if( cached != index_.end() )
+        {
+          ++hits_;
+          runs_.splice(runs_.begin(), runs_, cached->second);
+          return cached->second->run;
+        }
+
+        ++misses_;
+        auto run = std::make_shared<shaped_run>();
+        hb_buffer_clear_contents(buffer_.get());
+        hb_buffer_add_utf8(buffer_.get(), text.data(), static_cast<int>(text.size()), 0, -1);
+        hb_buffer_set_direction(buffer_.get(), direction);
+        hb_buffer_set_script(buffer_.get(), script);
+        hb_buffer_guess_segment_properties(buffer_.get());
+        hb_shape(hb_font_.get(), buffer_.get(), nullptr, 0);
+
+        unsigned int count = 0;
+        auto infos = hb_buffer_get_glyph_infos(buffer_.get(), &count);
+        auto positions = hb_buffer_get_glyph_positions(buffer_.get(), &count);
+        run->glyphs.reserve(count);
+        for( unsigned int i = 0; i < count; ++i )
+        {
+          run->glyphs.push_back(shaped_glyph{infos[i].codepoint,
+                                             infos[i].cluster,
+                                             positions[i].x_advance / 64.0f,
+                                             positions[i].x_offset / 64.0f,
+                                             positions[i].y_offset / 64.0f});
+          run->advance += positions[i].x_advance / 64.0f;
+        }
+
+        runs_.push_front(entry{k, run});
+        index_.emplace(std::move(k), runs_.begin());
+        if( runs_.size() > max_runs_ )
+        {
+          index_.erase(runs_.back().k);
+          runs_.pop_back();
+        }
+        return run;
+      }
+
+      /** Renders a glyph by glyph index, positioned relative to the pen at
+          the top of the line like render_glyph
+      */
+      glyph_bitmap render_glyph_index(Uint32 index)
+      {
+        glyph_bitmap g;
+        auto slot = ft_face_->glyph;
+        if( FT_Load_Glyph(ft_face_.get(), index, load_flags_) != 0 ||
+            FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL) != 0 )
+        {
+          return g;
+        }
+
+        g.advance = static_cast<int>(slot->advance.x >> 6);
+        g.x_offset = slot->bitmap_left;
+        g.y_offset = ascent_ - slot->bitmap_top;
+        auto& bitmap = slot->bitmap;
+        int w = static_cast<int>(bitmap.width);
+        int h = static_cast<int>(bitmap.rows);
+        if( w == 0 || h == 0 )
+        {
+          return g;
+        }
+
+        g.pixels.reset(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888));
+        if( !g.pixels )
+        {
+          sdl::throw_error("Failed to create glyph surface: ");
+        }
+        for( int y = 0; y < h; ++y )
+        {
+          auto src = bitmap.buffer + y * bitmap.pitch;
+          auto dst = reinterpret_cast<Uint32*>(static_cast<Uint8*>(g.pixels->pixels) + y * g.pixels->pitch);
+          for( int x = 0; x < w; ++x )
+          {
+            dst[x] = (Uint32(src[x]) << 24) | 0x00FFFFFF;
+          }
+        }
+        return g;
+      }
+
+      /** Queues a shaped run on a glyph atlas for the same font with the top
+          left of the line at (x, y).
+
+          Returns the pen position following the run.
+      */
+      float add(glyph_atlas& atlas, shaped_run const& run, float x, float y, SDL_Color const& c)
+      {
+        check_matches(atlas.get_font());
+        for( auto& sg : run.glyphs )
+        {
+          auto g = atlas.find(glyph_index_key(sg.index),
+                              [this, &sg]() { return render_glyph_index(sg.index); });
+          atlas.add(*g, x + sg.x_offset, y - sg.y_offset, c);
+          x += sg.x_advance;
+        }
+        return x;
+      }
+
+      /** Shapes and queues a UTF-8 string on a glyph atlas */
+      float add(glyph_atlas& atlas,
+                std::string_view text,
+                hb_direction_t direction,
+                hb_script_t script,
+                float x,
+                float y,
+                SDL_Color const& c)
+      {
+        return add(atlas, *shape(text, direction, script), x, y, c);
+      }
+
+      unsigned long hits() const
+      {
+        return hits_;
+      }
+
+      unsigned long misses() const
+      {
+        return misses_;
+      }
+
+      /** Returns the glyph_atlas key under which a glyph index is cached */
+      static Uint64 glyph_index_key(Uint32 index)
+      {
+        return (Uint64(1) << 32) | index;
+      }
+
+    private:
+      // The FreeType load flags SDL_ttf uses for each hinting setting
+      static FT_Int32 load_flags(int hinting)
+      {
+        switch( hinting )
+        {
+        case TTF_HINTING_LIGHT:
+          return FT_LOAD_TARGET_LIGHT;
+        case TTF_HINTING_MONO:
+          return FT_LOAD_TARGET_MONO;
+        case TTF_HINTING_NONE:
+          return FT_LOAD_NO_HINTING;
+        default:
+          return FT_LOAD_TARGET_NORMAL;
+        }
+      }
+
+      void check_matches(font const& f) const
+      {
+        auto same_name = [](char const* a, char const* b)
+        {
+          return (a == nullptr || b == nullptr) ? a == b : std::strcmp(a, b) == 0;
+        };
+        if( !same_name(TTF_FontFaceFamilyName(f.get()), ft_face_->family_name) ||
+            !same_name(TTF_FontFaceStyleName(f.get()), ft_face_->style_name) )
+        {
+          throw std::invalid_argument("text_shaper face does not match the atlas font");
+        }
+        if( TTF_FontAscent(f.get()) != ascent_ || TTF_FontHeight(f.get()) != height_ )
+        {
+          throw std::invalid_argument("text_shaper point size does not match the atlas font");
+        }
+        if( TTF_GetFontStyle(f.get()) != TTF_STYLE_NORMAL )
+        {
+          throw std::invalid_argument("text_shaper requires a font with TTF_STYLE_NORMAL");
+        }
+        if( TTF_GetFontHinting(f.get()) != hinting_ )
+        {
+          throw std::invalid_argument("text_shaper hinting does not match the atlas font");
+        }
+      }
+
+      struct key
+      {
+        std::string text;
+        hb_direction_t direction;
+        hb_script_t script;
+
+        bool operator==(key const& other) const
+        {
+          return direction == other.direction && script == other.script && text == other.text;
+        }
+      };
+
+      struct key_hash
+      {
+        std::size_t operator()(key const& k) const
+        {
+          auto h = std::hash<std::string>()(k.text);
+          h ^= std::hash<int>()(k.direction) + 0x9e3779b9 + (h << 6) + (h >> 2);
+          h ^= std::hash<Uint32>()(k.script) + 0x9e3779b9 + (h << 6) + (h >> 2);
+          return h;
+        }
+      };
+
+      struct entry
+      {
+        key k;
+        std::shared_ptr<shaped_run const> run;
+      };
+
+    private:
+      font_face face_;
+      std::unique_ptr<FT_LibraryRec_, decltype(&FT_Done_FreeType)> library_;
+      std::unique_ptr<FT_FaceRec_, decltype(&FT_Done_Face)> ft_face_;
+      std::unique_ptr<hb_font_t, decltype(&hb_font_destroy)> hb_font_;
+      std::unique_ptr<hb_buffer_t, decltype(&hb_buffer_destroy)> buffer_;
+      int ascent_ = 0;
+      int height_ = 0;
+      int hinting_;
+      FT_Int32 load_flags_;
+      std::size_t max_runs_;
+      unsigned long hits_ = 0;
+      unsigned long misses_ = 0;
+      std::list<entry> runs_;
+      std::unordered_map<key, std::list<entry>::iterator, key_hash> index_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_SHAPING_H
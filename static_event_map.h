@@ -0,0 +1,142 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_STATIC_EVENT_MAP_H
+#define SDL2_CPP_STATIC_EVENT_MAP_H
+
+#include "event.h"
+#include <functional>
+#include <SDL2/SDL.h>
+#include <tuple>
+#include <utility>
+
+namespace sdl2
+{
+  /** Handler for events of type Type in a static_event_map.
+
+      Calls f(<event>). If f returns true, the event is consumed.
+  */
+  template<Uint32 Type, class Function>
+  struct event_handler
+  {
+    Function f;
+
+    bool operator()(SDL_Event const& e)
+    {
+      return e.type == Type && std::invoke(f, e);
+    }
+  };
+
+  /** Handler for key down events of the key Key in a static_event_map.
+
+      Calls f(). Repeat events are rate limited as by
+      event_map::add_key_down_handler.
+  */
+  template<SDL_Keycode Key, class Function>
+  struct key_down_handler
+  {
+    Function f;
+    detail::key_repeat_limiter limiter{};
+
+    bool operator()(SDL_Event const& e)
+    {
+      if( e.type != SDL_KEYDOWN || e.key.keysym.sym != Key )
+      {
+        return false;
+      }
+      if( !limiter.rate_limited(e) )
+      {
+        std::invoke(f);
+      }
+      return true;
+    }
+  };
+
+  /** Handler for key up events of the key Key in a static_event_map.
+
+      Calls f().
+  */
+  template<SDL_Keycode Key, class Function>
+  struct key_up_handler
+  {
+    Function f;
+
+    bool operator()(SDL_Event const& e)
+    {
+      if( e.type != SDL_KEYUP || e.key.keysym.sym != Key )
+      {
+        return false;
+      }
+      std::invoke(f);
+      return true;
+    }
+  };
+
+  template<Uint32 Type, class Function>
+  event_handler<Type, Function> on(Function f)
+  {
+    return event_handler<Type, Function>{std::move(f)};
+  }
+
+  template<SDL_Keycode Key, class Function>
+  key_down_handler<Key, Function> on_key_down(Function f)
+  {
+    return key_down_handler<Key, Function>{std::move(f)};
+  }
+
+  template<SDL_Keycode Key, class Function>
+  key_up_handler<Key, Function> on_key_up(Function f)
+  {
+    return key_up_handler<Key, Function>{std::move(f)};
+  }
+
+  /** Map SDL events to a set of handlers fixed at compile time.
+
+      Behaves as an event_map with the same handlers added in the same
+      order, but the handlers are held by value and tested in turn against
+      constant event types and keycodes, so the compiler can inline them and
+      reduce dispatch to a branch on e.type. Nothing is allocated or type
+      erased.
+
+      Example:
+      ```
+      auto events = sdl2::make_event_map(
+        sdl2::on<SDL_QUIT>([&](SDL_Event const&) { return running = false, true; }),
+        sdl2::on_key_down<SDLK_ESCAPE>([&]() { running = false; }));
+      ```
+  */
+  template<class... Handlers>
+  class static_event_map
+  {
+  public:
+    explicit static_event_map(Handlers... handlers)
+      : handlers_(std::move(handlers)...)
+    {
+    }
+
+    /** Call the handler matching the event, if any.
+
+        If multiple matching handlers are present, tries each in turn until the
+        event is consumed.
+
+        If a matching handler is found, returns true, otherwise returns false.
+    */
+    bool handle_event(SDL_Event const& e)
+    {
+      return std::apply([&e](auto&... h) { return (h(e) || ...); }, handlers_);
+    }
+
+  private:
+    std::tuple<Handlers...> handlers_;
+  };
+
+  template<class... Handlers>
+  static_event_map<Handlers...> make_event_map(Handlers... handlers)
+  {
+    return static_event_map<Handlers...>(std::move(handlers)...);
+  }
+} // namespace sdl2
+
+#endif // SDL2_CPP_STATIC_EVENT_MAP_H
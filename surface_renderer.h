@@ -0,0 +1,147 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_SURFACE_RENDERER_H
+#define SDL2_CPP_SURFACE_RENDERER_H
+
+#include "font_metrics.h"
+#include "ttf.h"
+
+#include <string_view>
+#include <unordered_map>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** Composites text into existing surfaces.
+
+        Each glyph of the font is rendered once and kept as a small surface,
+        then blended into the destination at the requested colour. Once the
+        glyphs of a string have been seen, drawing it does not allocate, so a
+        caller-owned surface can be redrawn every frame.
+    */
+    class surface_renderer
+    {
+    public:
+      explicit surface_renderer(font f)
+        : font_(std::move(f))
+        , metrics_(font_)
+      {
+      }
+
+      surface_renderer(surface_renderer const&) = delete;
+      void operator=(surface_renderer const&) = delete;
+
+      font const& get_font() const
+      {
+        return font_;
+      }
+
+      font_metrics& metrics()
+      {
+        return metrics_;
+      }
+
+      /** Blends the specified UTF-8 string into dst with the top left of the
+          line at (x, y).
+
+          Drawing is limited to clip, if specified, as well as to the clip
+          rectangle already set on dst, which is left unchanged.
+
+          Returns the pen position following the last glyph.
+      */
+      int render_blended(std::string_view text,
+                         SDL_Color const& c,
+                         surface const& dst,
+                         int x,
+                         int y,
+                         SDL_Rect const* clip = nullptr)
+      {
+        SDL_Rect saved_clip;
+        SDL_GetClipRect(dst.get(), &saved_clip);
+        if( clip != nullptr )
+        {
+          SDL_Rect limited;
+          if( !SDL_IntersectRect(&saved_clip, clip, &limited) )
+          {
+            return x + pen_advance(text);
+          }
+          SDL_SetClipRect(dst.get(), &limited);
+        }
+
+        Uint32 previous = 0;
+        std::size_t pos = 0;
+        while( pos < text.size() )
+        {
+          auto cp = next_code_point(text, pos);
+          if( previous != 0 )
+          {
+            x += metrics_.kerning(previous, cp);
+          }
+          auto& g = find(cp);
+          if( g.pixels )
+          {
+            SDL_SetSurfaceColorMod(g.pixels.get(), c.r, c.g, c.b);
+            SDL_SetSurfaceAlphaMod(g.pixels.get(), c.a);
+            SDL_Rect at{x + g.x_offset, y + g.y_offset, g.pixels->w, g.pixels->h};
+            SDL_BlitSurface(g.pixels.get(), nullptr, dst.get(), &at);
+          }
+          x += g.advance;
+          previous = cp;
+        }
+
+        if( clip != nullptr )
+        {
+          SDL_SetClipRect(dst.get(), &saved_clip);
+        }
+        return x;
+      }
+
+    private:
+      // The sum of advances and kerning for text, as render_blended moves
+      // the pen
+      int pen_advance(std::string_view text)
+      {
+        int x = 0;
+        Uint32 previous = 0;
+        std::size_t pos = 0;
+        while( pos < text.size() )
+        {
+          auto cp = next_code_point(text, pos);
+          if( previous != 0 )
+          {
+            x += metrics_.kerning(previous, cp);
+          }
+          x += metrics_.advance(cp);
+          previous = cp;
+        }
+        return x;
+      }
+
+      glyph_bitmap const& find(Uint32 code_point)
+      {
+        auto cached = glyphs_.find(code_point);
+        if( cached == glyphs_.end() )
+        {
+          auto g = render_glyph(font_, code_point);
+          if( g.pixels )
+          {
+            SDL_SetSurfaceBlendMode(g.pixels.get(), SDL_BLENDMODE_BLEND);
+          }
+          cached = glyphs_.emplace(code_point, std::move(g)).first;
+        }
+        return cached->second;
+      }
+
+    private:
+      font font_;
+      font_metrics metrics_;
+      std::unordered_map<Uint32, glyph_bitmap> glyphs_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_SURFACE_RENDERER_H
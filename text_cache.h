@@ -0,0 +1,192 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_TEXT_CACHE_H
+#define SDL2_CPP_TEXT_CACHE_H
+
+#include "ttf.h"
+
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** Caches textures of rendered text.
+
+        Textures are keyed by font, UTF-8 text and colour and are evicted in
+        least recently used order once the bytes held exceed the budget. A
+        texture still referenced by the caller after eviction stays valid but
+        no longer counts towards the budget.
+
+        The renderer must outlive the cache.
+    */
+    class text_cache
+    {
+    public:
+      explicit text_cache(renderer const& r, std::size_t budget_bytes = 64 << 20)
+        : r_(r)
+        , budget_(budget_bytes)
+      {
+      }
+
+      text_cache(text_cache const&) = delete;
+      void operator=(text_cache const&) = delete;
+
+      /** Returns a texture of the specified text rendered with
+          render_blended, rendering it only if it is not already cached.
+
+          Returns an empty pointer if the text could not be rendered, e.g.
+          because it is empty.
+      */
+      shared_texture get(font const& f, std::string const& text, SDL_Color const& c)
+      {
+        key k{f.get(), text, pack(c)};
+        auto cached = index_.find(k);
+        if( cached != index_.end() )
+        {
+          ++hits_;
+          entries_.splice(entries_.begin(), entries_, cached->second);
+          return cached->second->tex;
+        }
+
+        ++misses_;
+        auto s = render_blended(f, text, c);
+        if( !s )
+        {
+          return shared_texture();
+        }
+        shared_texture t(create_texture_from_surface(r_, s).release(),
+                         SDL_DestroyTexture);
+        if( !t )
+        {
+          return t;
+        }
+
+        std::size_t bytes = static_cast<std::size_t>(s->w) * s->h * 4;
+        entries_.push_front(entry{k, f, t, bytes});
+        index_.emplace(std::move(k), entries_.begin());
+        resident_ += bytes;
+        evict();
+        return t;
+      }
+
+      /** Sets the maximum number of bytes of texture data to keep */
+      void set_budget(std::size_t budget_bytes)
+      {
+        budget_ = budget_bytes;
+        evict();
+      }
+
+      std::size_t budget() const
+      {
+        return budget_;
+      }
+
+      /** Returns the estimated bytes of texture data held by the cache */
+      std::size_t resident_bytes() const
+      {
+        return resident_;
+      }
+
+      /** Returns the number of cached textures */
+      std::size_t size() const
+      {
+        return entries_.size();
+      }
+
+      unsigned long hits() const
+      {
+        return hits_;
+      }
+
+      unsigned long misses() const
+      {
+        return misses_;
+      }
+
+      /** Returns the fraction of lookups served from the cache */
+      double hit_rate() const
+      {
+        auto lookups = hits_ + misses_;
+        return lookups == 0 ? 0.0 : static_cast<double>(hits_) / lookups;
+      }
+
+      /** Releases all cached textures */
+      void clear()
+      {
+        index_.clear();
+        entries_.clear();
+        resident_ = 0;
+      }
+
+    private:
+      struct key
+      {
+        TTF_Font* f;
+        std::string text;
+        Uint32 colour;
+
+        bool operator==(key const& other) const
+        {
+          return f == other.f && colour == other.colour && text == other.text;
+        }
+      };
+
+      struct key_hash
+      {
+        std::size_t operator()(key const& k) const
+        {
+          auto h = std::hash<std::string>()(k.text);
+          h ^= std::hash<TTF_Font*>()(k.f) + 0x9e3779b9 + (h << 6) + (h >> 2);
+          h ^= std::hash<Uint32>()(k.colour) + 0x9e3779b9 + (h << 6) + (h >> 2);
+          return h;
+        }
+      };
+
+      // The font is held so its address cannot be reused by another font
+      // while the entry exists
+      struct entry
+      {
+        key k;
+        font f;
+        shared_texture tex;
+        std::size_t bytes;
+      };
+
+      static Uint32 pack(SDL_Color const& c)
+      {
+        return (Uint32(c.r) << 24) | (Uint32(c.g) << 16) | (Uint32(c.b) << 8) | c.a;
+      }
+
+      // Keeps at least the most recently used entry, even if it alone
+      // exceeds the budget
+      void evict()
+      {
+        while( resident_ > budget_ && entries_.size() > 1 )
+        {
+          auto& last = entries_.back();
+          resident_ -= last.bytes;
+          index_.erase(last.k);
+          entries_.pop_back();
+        }
+      }
+
+    private:
+      renderer const& r_;
+      std::size_t budget_;
+      std::size_t resident_ = 0;
+      unsigned long hits_ = 0;
+      unsigned long misses_ = 0;
+      std::list<entry> entries_;
+      std::unordered_map<key, std::list<entry>::iterator, key_hash> index_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_TEXT_CACHE_H
@@ -0,0 +1,323 @@
+// Header only C++ wrapper library for SDL2
+//
+// Copyright Ian Wakeling 2020
+// License MIT
+
+#ifndef SDL2_CPP_TEXT_EFFECTS_H
+#define SDL2_CPP_TEXT_EFFECTS_H
+
+#include "glyph_atlas.h"
+#include "ttf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sdl
+{
+  namespace ttf
+  {
+    /** Appearance of text drawn by text_effects. An outline or blur radius of
+        0 disables that effect.
+    */
+    struct text_style
+    {
+      SDL_Color colour = white;
+      int outline = 0;
+      SDL_Color outline_colour = black;
+      bool shadow = false;
+      int shadow_x = 2;
+      int shadow_y = 2;
+      int shadow_blur = 0;
+      SDL_Color shadow_colour{0x00, 0x00, 0x00, 0x80};
+    };
+
+    /** Draws outlined and shadowed text through a glyph atlas.
+
+        Each glyph is rasterized once, and its alpha mask is kept. Outlines are
+        made by dilating the mask and soft shadows by blurring it, both with
+        separable kernels, so the font's outline setting is never changed and
+        the font can be shared. Each variant is cached in the atlas under its
+        own key, so text with effects is drawn in the same single batch as
+        plain text.
+
+        The atlas must outlive the text_effects.
+    */
+    class text_effects
+    {
+    public:
+      explicit text_effects(glyph_atlas& atlas)
+        : atlas_(atlas)
+      {
+      }
+
+      text_effects(text_effects const&) = delete;
+      void operator=(text_effects const&) = delete;
+
+      /** Queues the specified UTF-8 string with the top left of the line at
+          (x, y). Shadows of the whole string are queued first, then outlines,
+          then the text itself, so no glyph's effect covers its neighbour.
+
+          Returns the pen position following the last glyph.
+      */
+      float add(std::string_view text, float x, float y, text_style const& s)
+      {
+        int outline = std::clamp(s.outline, 0, max_radius);
+        int blur = std::clamp(s.shadow_blur, 0, max_radius);
+        if( s.shadow )
+        {
+          queue(text, x + s.shadow_x, y + s.shadow_y, outline, blur, s.shadow_colour);
+        }
+        if( outline > 0 )
+        {
+          queue(text, x, y, outline, 0, s.outline_colour);
+        }
+        return queue(text, x, y, 0, 0, s.colour);
+      }
+
+      /** Queues and immediately draws the specified UTF-8 string */
+      float draw(std::string_view text, float x, float y, text_style const& s)
+      {
+        x = add(text, x, y, s);
+        atlas_.render();
+        return x;
+      }
+
+      /** Discards the cached glyph masks. Variants already uploaded to the
+          atlas remain until the atlas is cleared.
+      */
+      void clear()
+      {
+        masks_.clear();
+      }
+
+    private:
+      static constexpr int max_radius = 0xFF;
+
+      // Alpha coverage of a glyph, positioned like a glyph_bitmap
+      struct mask
+      {
+        int w = 0;
+        int h = 0;
+        int x_offset = 0;
+        int y_offset = 0;
+        int advance = 0;
+        std::vector<Uint8> alpha;
+      };
+
+      float queue(std::string_view text, float x, float y, int outline, int blur, SDL_Color const& c)
+      {
+        auto& metrics = atlas_.metrics();
+        Uint32 previous = 0;
+        std::size_t pos = 0;
+        while( pos < text.size() )
+        {
+          auto cp = next_code_point(text, pos);
+          if( previous != 0 )
+          {
+            x += metrics.kerning(previous, cp);
+          }
+          auto g = find(cp, outline, blur);
+          atlas_.add(*g, x, y, c);
+          x += g->advance;
+          previous = cp;
+        }
+        return x;
+      }
+
+      // Variants live above the code point and shaped glyph keys, with the
+      // radii in the bits between
+      glyph_atlas::glyph const* find(Uint32 code_point, int outline, int blur)
+      {
+        Uint64 key = code_point;
+        if( outline > 0 || blur > 0 )
+        {
+          key |= (Uint64(1) << 56) | (Uint64(outline) << 48) | (Uint64(blur) << 40);
+        }
+        return atlas_.find(key, [this, code_point, outline, blur]()
+        {
+          auto m = get_mask(code_point);
+          if( outline > 0 )
+          {
+            m = dilate(m, outline);
+          }
+          if( blur > 0 )
+          {
+            m = blur_mask(m, blur);
+          }
+          return to_bitmap(code_point, m);
+        });
+      }
+
+      mask const& get_mask(Uint32 code_point)
+      {
+        auto cached = masks_.find(code_point);
+        if( cached != masks_.end() )
+        {
+          return cached->second;
+        }
+
+        auto bitmap = render_glyph(atlas_.get_font(), code_point);
+        mask m;
+        m.x_offset = bitmap.x_offset;
+        m.y_offset = bitmap.y_offset;
+        m.advance = bitmap.advance;
+        if( bitmap.pixels )
+        {
+          m.w = bitmap.pixels->w;
+          m.h = bitmap.pixels->h;
+          m.alpha.resize(m.w * m.h);
+          for( int y = 0; y < m.h; ++y )
+          {
+            auto row = reinterpret_cast<Uint32 const*>(
+              static_cast<Uint8 const*>(bitmap.pixels->pixels) + y * bitmap.pixels->pitch);
+            for( int x = 0; x < m.w; ++x )
+            {
+              m.alpha[y * m.w + x] = static_cast<Uint8>(row[x] >> 24);
+            }
+          }
+        }
+        return masks_.emplace(code_point, std::move(m)).first->second;
+      }
+
+      // Returns a copy of a mask with a border of r transparent pixels
+      static mask pad(mask const& m, int r)
+      {
+        mask p;
+        p.w = m.w + 2 * r;
+        p.h = m.h + 2 * r;
+        p.x_offset = m.x_offset - r;
+        p.y_offset = m.y_offset - r;
+        p.advance = m.advance;
+        p.alpha.assign(p.w * p.h, 0);
+        for( int y = 0; y < m.h; ++y )
+        {
+          std::copy_n(&m.alpha[y * m.w], m.w, &p.alpha[(y + r) * p.w + r]);
+        }
+        return p;
+      }
+
+      // Maximum over a square of side 2r + 1, as a horizontal pass followed
+      // by a vertical one
+      static mask dilate(mask const& m, int r)
+      {
+        if( m.w == 0 )
+        {
+          return m;
+        }
+        auto p = pad(m, r);
+        std::vector<Uint8> rows(p.alpha.size());
+        for( int y = 0; y < p.h; ++y )
+        {
+          auto src = &p.alpha[y * p.w];
+          for( int x = 0; x < p.w; ++x )
+          {
+            auto first = src + std::max(0, x - r);
+            auto last = src + std::min(p.w, x + r + 1);
+            rows[y * p.w + x] = *std::max_element(first, last);
+          }
+        }
+        for( int x = 0; x < p.w; ++x )
+        {
+          for( int y = 0; y < p.h; ++y )
+          {
+            Uint8 v = 0;
+            for( int i = std::max(0, y - r); i < std::min(p.h, y + r + 1); ++i )
+            {
+              v = std::max(v, rows[i * p.w + x]);
+            }
+            p.alpha[y * p.w + x] = v;
+          }
+        }
+        return p;
+      }
+
+      // Gaussian blur with a standard deviation of r / 2, as a horizontal
+      // pass followed by a vertical one
+      static mask blur_mask(mask const& m, int r)
+      {
+        if( m.w == 0 )
+        {
+          return m;
+        }
+        auto p = pad(m, r);
+        std::vector<float> kernel(2 * r + 1);
+        float sigma = r / 2.0f;
+        float total = 0.0f;
+        for( int i = -r; i <= r; ++i )
+        {
+          kernel[i + r] = std::exp(-(i * i) / (2.0f * sigma * sigma));
+          total += kernel[i + r];
+        }
+        for( auto& k : kernel )
+        {
+          k /= total;
+        }
+
+        std::vector<float> rows(p.alpha.size());
+        for( int y = 0; y < p.h; ++y )
+        {
+          for( int x = 0; x < p.w; ++x )
+          {
+            float v = 0.0f;
+            for( int i = std::max(0, x - r); i < std::min(p.w, x + r + 1); ++i )
+            {
+              v += kernel[i - x + r] * p.alpha[y * p.w + i];
+            }
+            rows[y * p.w + x] = v;
+          }
+        }
+        for( int x = 0; x < p.w; ++x )
+        {
+          for( int y = 0; y < p.h; ++y )
+          {
+            float v = 0.0f;
+            for( int i = std::max(0, y - r); i < std::min(p.h, y + r + 1); ++i )
+            {
+              v += kernel[i - y + r] * rows[i * p.w + x];
+            }
+            p.alpha[y * p.w + x] = static_cast<Uint8>(std::min(255.0f, v + 0.5f));
+          }
+        }
+        return p;
+      }
+
+      // White pixels with the mask as alpha, for colouring by the atlas
+      static glyph_bitmap to_bitmap(Uint32 code_point, mask const& m)
+      {
+        glyph_bitmap g;
+        g.code_point = code_point;
+        g.x_offset = m.x_offset;
+        g.y_offset = m.y_offset;
+        g.advance = m.advance;
+        if( m.w == 0 || m.h == 0 )
+        {
+          return g;
+        }
+
+        g.pixels.reset(SDL_CreateRGBSurfaceWithFormat(0, m.w, m.h, 32, SDL_PIXELFORMAT_ARGB8888));
+        if( !g.pixels )
+        {
+          sdl::throw_error("Failed to create glyph surface: ");
+        }
+        for( int y = 0; y < m.h; ++y )
+        {
+          auto row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(g.pixels->pixels) + y * g.pixels->pitch);
+          for( int x = 0; x < m.w; ++x )
+          {
+            row[x] = (Uint32(m.alpha[y * m.w + x]) << 24) | 0x00FFFFFF;
+          }
+        }
+        return g;
+      }
+
+    private:
+      glyph_atlas& atlas_;
+      std::unordered_map<Uint32, mask> masks_;
+    };
+  }
+}
+
+#endif // SDL2_CPP_TEXT_EFFECTS_H
@@ -8,9 +8,18 @@
 
 #include "sdl2.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <fontconfig/fontconfig.h>
+#include <mutex>
 #include <SDL2/SDL_ttf.h>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 namespace sdl
 {
@@ -24,7 +33,283 @@ namespace sdl
       throw std::runtime_error(prefix + TTF_GetError());
     }
 
-    /** RAII class to initialise and release the TTF library */
+    /** Number and total duration of calls to one text operation */
+    struct op_stats
+    {
+      unsigned long calls = 0;
+      std::uint64_t nanoseconds = 0;
+    };
+
+    /** Counters for the text operations of the library.
+
+        Counting is compiled in only when SDL2_CPP_TTF_STATS is defined,
+        which must be consistent across translation units; otherwise all
+        counters stay at zero and cost nothing.
+    */
+    struct text_stats
+    {
+      op_stats font_matches;  // fontconfig FcFontMatch and FcFontSort
+      op_stats font_opens;    // TTF_OpenFont and TTF_OpenFontRW
+      op_stats size_calls;    // TTF_SizeUTF8
+      op_stats renders;       // TTF_RenderUTF8_Blended
+      op_stats glyph_renders; // TTF_RenderGlyph32_Blended
+      std::uint64_t surface_bytes = 0;
+    };
+
+    namespace detail
+    {
+      struct op_counter
+      {
+        std::atomic<unsigned long> calls{0};
+        std::atomic<std::uint64_t> nanoseconds{0};
+
+        op_stats load() const
+        {
+          return op_stats{calls.load(), nanoseconds.load()};
+        }
+      };
+
+      struct stats_counters
+      {
+        op_counter font_matches;
+        op_counter font_opens;
+        op_counter size_calls;
+        op_counter renders;
+        op_counter glyph_renders;
+        std::atomic<std::uint64_t> surface_bytes{0};
+
+        text_stats load() const
+        {
+          text_stats s;
+          s.font_matches = font_matches.load();
+          s.font_opens = font_opens.load();
+          s.size_calls = size_calls.load();
+          s.renders = renders.load();
+          s.glyph_renders = glyph_renders.load();
+          s.surface_bytes = surface_bytes.load();
+          return s;
+        }
+      };
+
+      inline stats_counters& counters()
+      {
+        static stats_counters c;
+        return c;
+      }
+
+      /** Counts a call to an operation and adds its duration on destruction */
+      class timed_op
+      {
+      public:
+#ifdef SDL2_CPP_TTF_STATS
+        explicit timed_op(op_counter& c)
+          : counter_(c)
+          , start_(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~timed_op()
+        {
+          auto elapsed = std::chrono::steady_clock::now() - start_;
+          counter_.calls.fetch_add(1, std::memory_order_relaxed);
+          counter_.nanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+            std::memory_order_relaxed);
+        }
+
+      private:
+        op_counter& counter_;
+        std::chrono::steady_clock::time_point start_;
+#else
+        explicit timed_op(op_counter&)
+        {
+        }
+#endif
+        timed_op(timed_op const&) = delete;
+        void operator=(timed_op const&) = delete;
+      };
+
+      /** Counts the pixel bytes of a surface produced by SDL_ttf */
+      inline SDL_Surface* count_surface(SDL_Surface* s)
+      {
+#ifdef SDL2_CPP_TTF_STATS
+        if( s != nullptr )
+        {
+          counters().surface_bytes.fetch_add(
+            static_cast<std::uint64_t>(s->pitch) * s->h,
+            std::memory_order_relaxed);
+        }
+#endif
+        return s;
+      }
+
+      inline op_stats difference(op_stats const& now, op_stats const& then)
+      {
+        return op_stats{now.calls - then.calls, now.nanoseconds - then.nanoseconds};
+      }
+    }
+
+    /** Returns the text operation counters accumulated since startup */
+    inline text_stats total_stats()
+    {
+      return detail::counters().load();
+    }
+
+    /** Returns the text operation counters accumulated since the previous
+        call, e.g. once per frame
+    */
+    inline text_stats frame_stats()
+    {
+      static std::mutex m;
+      static text_stats previous;
+      std::lock_guard<std::mutex> lock(m);
+      auto now = total_stats();
+      text_stats frame;
+      frame.font_matches = detail::difference(now.font_matches, previous.font_matches);
+      frame.font_opens = detail::difference(now.font_opens, previous.font_opens);
+      frame.size_calls = detail::difference(now.size_calls, previous.size_calls);
+      frame.renders = detail::difference(now.renders, previous.renders);
+      frame.glyph_renders = detail::difference(now.glyph_renders, previous.glyph_renders);
+      frame.surface_bytes = now.surface_bytes - previous.surface_bytes;
+      previous = now;
+      return frame;
+    }
+
+    /** Resolves fontconfig font names to font file paths.
+
+        The fontconfig configuration is loaded once on construction and
+        released on destruction. Matches are memoized, so resolving the same
+        name again does not query fontconfig.
+    */
+    class font_resolver
+    {
+    public:
+      font_resolver()
+        : config_(FcInitLoadConfigAndFonts(), FcConfigDestroy)
+      {
+      }
+
+      font_resolver(font_resolver const&) = delete;
+      void operator=(font_resolver const&) = delete;
+
+      /** Returns the path of the file best matching the specified font
+          name, or an empty string if there is no match
+      */
+      std::string resolve(std::string const& font_name)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto cached = matches_.find(font_name);
+        if( cached != matches_.end() )
+        {
+          ++hits_;
+          return cached->second;
+        }
+
+        ++misses_;
+        auto font_file = match(font_name);
+        matches_.emplace(font_name, font_file);
+        return font_file;
+      }
+
+      /** Calls f(file, index, charset) for each font suitable for the
+          specified font name, best match first, as ordered by FcFontSort.
+          index is the face's index within a font collection file. Fonts
+          adding no coverage to earlier ones are skipped. Sort results are not
+          memoized.
+      */
+      template<class Function>
+      void sort(std::string const& font_name, Function&& f)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        detail::timed_op timed(detail::counters().font_matches);
+        auto pat = FcNameParse(reinterpret_cast<FcChar8 const*>(font_name.c_str()));
+        FcConfigSubstitute(config_.get(), pat, FcMatchPattern);
+        FcDefaultSubstitute(pat);
+
+        auto result = FcResultNoMatch;
+        auto set = FcFontSort(config_.get(), pat, FcTrue, nullptr, &result);
+        if( set != nullptr )
+        {
+          for( int i = 0; i < set->nfont; ++i )
+          {
+            FcChar8* file_name = NULL;
+            FcCharSet* charset = NULL;
+            int index = 0;
+            if( FcPatternGetString(set->fonts[i], FC_FILE, 0, &file_name) == FcResultMatch &&
+                FcPatternGetCharSet(set->fonts[i], FC_CHARSET, 0, &charset) == FcResultMatch )
+            {
+              FcPatternGetInteger(set->fonts[i], FC_INDEX, 0, &index);
+              f(reinterpret_cast<char const*>(file_name),
+                index,
+                static_cast<FcCharSet const*>(charset));
+            }
+          }
+          FcFontSetDestroy(set);
+        }
+        FcPatternDestroy(pat);
+      }
+
+      /** Discards all memoized matches, e.g. after fonts are installed */
+      void clear()
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        matches_.clear();
+      }
+
+      /** Returns the number of names resolved from the memo */
+      unsigned long hits() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hits_;
+      }
+
+      /** Returns the number of names resolved by querying fontconfig */
+      unsigned long misses() const
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return misses_;
+      }
+
+    private:
+      std::string match(std::string const& font_name)
+      {
+        detail::timed_op timed(detail::counters().font_matches);
+        auto pat = FcNameParse(reinterpret_cast<FcChar8 const*>(font_name.c_str()));
+        FcConfigSubstitute(config_.get(), pat, FcMatchPattern);
+        FcDefaultSubstitute(pat);
+
+        auto result = FcResultNoMatch;
+        auto match = FcFontMatch(config_.get(), pat, &result);
+        std::string font_file;
+        if( result == FcResultMatch && match != nullptr )
+        {
+          FcChar8* file_name = NULL;
+          if( FcPatternGetString(match, FC_FILE, 0, &file_name) == FcResultMatch )
+          {
+            font_file = reinterpret_cast<char const*>(file_name);
+          }
+        }
+        if( match != nullptr )
+        {
+          FcPatternDestroy(match);
+        }
+        FcPatternDestroy(pat);
+        return font_file;
+      }
+
+    private:
+      std::unique_ptr<FcConfig, decltype(&FcConfigDestroy)> config_;
+      mutable std::mutex mutex_;
+      std::unordered_map<std::string, std::string> matches_;
+      unsigned long hits_ = 0;
+      unsigned long misses_ = 0;
+    };
+
+    /** RAII class to initialise and release the TTF library
+
+        While a lib exists it owns the process-wide font_resolver used by
+        open_font.
+    */
     struct lib
     {
       lib()
@@ -33,12 +318,38 @@ namespace sdl
         {
           throw_error("Failed to initialise SDL TTF support: ");
         }
+        current() = this;
       }
 
       ~lib()
       {
+        if( current() == this )
+        {
+          current() = nullptr;
+        }
         TTF_Quit();
       }
+
+      lib(lib const&) = delete;
+      void operator=(lib const&) = delete;
+
+      /** Returns the resolver of the current lib, or nullptr if the TTF
+          library has not been initialised
+      */
+      static font_resolver* resolver()
+      {
+        auto l = current();
+        return l != nullptr ? &l->resolver_ : nullptr;
+      }
+
+    private:
+      static lib*& current()
+      {
+        static lib* instance = nullptr;
+        return instance;
+      }
+
+      font_resolver resolver_;
     };
 
     /** Initialises the TTF library and returns a token whose destruction
@@ -53,36 +364,59 @@ namespace sdl
     using font = std::shared_ptr<TTF_Font>;
 
     /** std::weak_ptr for TTF_Font. This can be used to implement a simple font
-        cache
+        cache; font_registry provides a thread safe one
     */
     using font_cache = std::weak_ptr<TTF_Font>;
 
+    /** Mutex serialising font opening and closing across threads.
+
+        SDL_ttf shares a single FreeType library handle between fonts, which
+        FreeType does not allow to be used for creating or destroying faces
+        concurrently.
+    */
+    inline std::mutex& library_mutex()
+    {
+      static std::mutex m;
+      return m;
+    }
+
+    /** Closes a font while holding the library mutex */
+    inline void close_font(TTF_Font* f)
+    {
+      std::lock_guard<std::mutex> lock(library_mutex());
+      TTF_CloseFont(f);
+    }
+
+    /** Returns the path of the file best matching a font name, using the
+        resolver of the current lib if there is one
+    */
+    inline std::string resolve_font(std::string const& font_name)
+    {
+      if( auto resolver = lib::resolver() )
+      {
+        return resolver->resolve(font_name);
+      }
+      return font_resolver().resolve(font_name);
+    }
+
     /** Creates a TTF font object from a font name
 
+        The name is resolved through the font_resolver owned by the current
+        lib, so repeated names do not rescan the font directories.
+
         The font is owned by the returned unique_ptr
     */
     template<class ...Ts>
     font open_font(std::string const& font_name, Ts... args)
     {
-      auto config = FcInitLoadConfigAndFonts();
-      auto pat = FcNameParse(reinterpret_cast<FcChar8 const*>(font_name.c_str()));
-      FcConfigSubstitute(config, pat, FcMatchPattern);
-      FcDefaultSubstitute(pat);
-
-      auto result = FcResultNoMatch;
-      auto match = FcFontMatch(config, pat, &result);
-      std::string font_file;
-      if( result == FcResultMatch && match != nullptr )
+      auto font_file = resolve_font(font_name);
+      detail::timed_op timed(detail::counters().font_opens);
+      TTF_Font* f = nullptr;
       {
-        FcChar8* file_name = NULL;
-        if( FcPatternGetString(match, FC_FILE, 0, &file_name) == FcResultMatch )
-        {
-          font_file = reinterpret_cast<char const*>(file_name);
-        }
-        FcPatternDestroy(match);
+        std::lock_guard<std::mutex> lock(library_mutex());
+        f = TTF_OpenFont(font_file.c_str(), args...);
       }
-      FcPatternDestroy(pat);
-      return font(TTF_OpenFont(font_file.c_str(), args...), TTF_CloseFont);
+      return font(f, close_font);
     }
 
     /** Creates a TTF font object from a font file name
@@ -92,7 +426,13 @@ namespace sdl
     template<class ...Ts>
     font open_font_file(Ts... args)
     {
-      return font(TTF_OpenFont(args...), TTF_CloseFont);
+      detail::timed_op timed(detail::counters().font_opens);
+      TTF_Font* f = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(library_mutex());
+        f = TTF_OpenFont(args...);
+      }
+      return font(f, close_font);
     }
 
     /** Returns the width in pixels of the specified string when rendered
@@ -101,6 +441,7 @@ namespace sdl
     template<class ...Ts>
     void size(font const& f, std::string const& text, Ts... args)
     {
+      detail::timed_op timed(detail::counters().size_calls);
       TTF_SizeUTF8(f.get(), text.c_str(), args...);
     }
 
@@ -111,9 +452,132 @@ namespace sdl
     template<class ...Ts>
     surface render_blended(font const& f, std::string const& text, Ts... args)
     {
-      return surface(TTF_RenderUTF8_Blended(f.get(), text.c_str(), args...),
+      detail::timed_op timed(detail::counters().renders);
+      return surface(detail::count_surface(
+                       TTF_RenderUTF8_Blended(f.get(), text.c_str(), args...)),
                      SDL_FreeSurface);
     }
+
+    /** Decodes the UTF-8 code point starting at text[pos] and advances pos
+        past it. Malformed sequences decode as U+FFFD.
+    */
+    inline Uint32 next_code_point(std::string_view text, std::size_t& pos)
+    {
+      auto lead = static_cast<unsigned char>(text[pos++]);
+      if( lead < 0x80 )
+      {
+        return lead;
+      }
+
+      int length = (lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0);
+      if( length == 0 || lead > 0xF4 )
+      {
+        return 0xFFFD;
+      }
+
+      Uint32 cp = lead & (0x3F >> length);
+      for( int i = 0; i < length; ++i )
+      {
+        if( pos == text.size() ||
+            (static_cast<unsigned char>(text[pos]) & 0xC0) != 0x80 )
+        {
+          return 0xFFFD;
+        }
+        cp = (cp << 6) | (static_cast<unsigned char>(text[pos++]) & 0x3F);
+      }
+      return cp;
+    }
+
+    /** A single glyph rendered in white.
+
+        The pixels are cropped to the inked area and positioned relative to
+        the pen at the top of the line. Blank glyphs such as spaces have no
+        pixels, only an advance.
+    */
+    struct glyph_bitmap
+    {
+      Uint32 code_point = 0;
+      surface pixels{nullptr, SDL_FreeSurface};
+      int x_offset = 0;
+      int y_offset = 0;
+      int advance = 0;
+    };
+
+    /** Renders a single glyph of the specified font */
+    inline glyph_bitmap render_glyph(font const& f, Uint32 code_point)
+    {
+      glyph_bitmap g;
+      g.code_point = code_point;
+
+      int minx = 0;
+      int maxx = 0;
+      int miny = 0;
+      int maxy = 0;
+      TTF_GlyphMetrics32(f.get(), code_point, &minx, &maxx, &miny, &maxy, &g.advance);
+
+      surface rendered(nullptr, SDL_FreeSurface);
+      {
+        detail::timed_op timed(detail::counters().glyph_renders);
+        rendered.reset(detail::count_surface(
+                         TTF_RenderGlyph32_Blended(f.get(), code_point, white)));
+      }
+      if( !rendered )
+      {
+        return g;
+      }
+
+      surface argb(SDL_ConvertSurfaceFormat(rendered.get(), SDL_PIXELFORMAT_ARGB8888, 0),
+                   SDL_FreeSurface);
+      if( !argb )
+      {
+        return g;
+      }
+
+      // Crop to the rows and columns with non-zero alpha
+      auto pixel = [&argb](int x, int y) -> Uint32 const&
+      {
+        auto row = static_cast<Uint8 const*>(argb->pixels) + y * argb->pitch;
+        return reinterpret_cast<Uint32 const*>(row)[x];
+      };
+      int left = argb->w;
+      int right = -1;
+      int top = argb->h;
+      int bottom = -1;
+      for( int y = 0; y < argb->h; ++y )
+      {
+        for( int x = 0; x < argb->w; ++x )
+        {
+          if( (pixel(x, y) >> 24) != 0 )
+          {
+            left = std::min(left, x);
+            right = std::max(right, x);
+            top = std::min(top, y);
+            bottom = std::max(bottom, y);
+          }
+        }
+      }
+      if( right < 0 )
+      {
+        return g;
+      }
+
+      int w = right - left + 1;
+      int h = bottom - top + 1;
+      g.pixels.reset(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888));
+      if( !g.pixels )
+      {
+        sdl::throw_error("Failed to create glyph surface: ");
+      }
+      for( int y = 0; y < h; ++y )
+      {
+        std::memcpy(static_cast<Uint8*>(g.pixels->pixels) + y * g.pixels->pitch,
+                    &pixel(left, top + y),
+                    w * sizeof(Uint32));
+      }
+      g.x_offset = std::min(0, minx) + left;
+      g.y_offset = top;
+      return g;
+    }
   }
 }
 